@@ -0,0 +1,183 @@
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
+
+#include "BatchRunner.h"
+#include "ParameterSweep.h"
+#include "VideoEvaluation.h"
+
+namespace {
+void printUsage(const char *name) {
+    std::cerr << "Usage: " << name << " [options] <config.json> <video|image directory> <output>" << std::endl
+              << std::endl
+              << "The results are written as binary taglist file if <output> ends with .bbtags, as CSV otherwise." << std::endl
+              << std::endl
+              << "Options:" << std::endl
+              << "  --stage <localizer|ellipsefitter|gridfitter|decoder>  last stage to run (default: decoder)" << std::endl
+              << "  --max-frames <n>                                      stop after n frames" << std::endl
+              << "  --input-format <format>                               auto, gray, bgr, mono-bgr, bgra, bayer-bg, bayer-gb," << std::endl
+              << "                                                        bayer-rg, bayer-gr, mono12 or mono16 (default: auto)" << std::endl
+              << "  --pipelined                                           run every stage on its own thread" << std::endl
+              << "  --instances <n>                                       process whole frames on n pipeline instances, 0: all cores" << std::endl
+              << "  --queue-size <n>                                      capacity of the queues between stages (default: 4)" << std::endl
+              << "  --threads <n>                                         threads of the per-tag stages, 0: all cores (default: 1)" << std::endl
+              << "  --tile-size <n>                                       localize on tiles of n x n pixels in parallel" << std::endl
+              << "  --halo <n>                                            overlap of the tiles (default and minimum: tag size)" << std::endl
+              << "  --tile-threads <n>                                    threads processing the tiles, 0: all cores (default: 0)" << std::endl
+              << "  --checkpoint <directory>                              write the output of every stage to the directory" << std::endl
+              << "  --resume <localizer|ellipsefitter|gridfitter>         with --checkpoint: read the output of the stage from the" << std::endl
+              << "                                                        directory and only run the following stages" << std::endl
+              << "  --ground-truth <file.tdat>                            evaluate all stages on the annotated frames and write" << std::endl
+              << "                                                        the report to <output>.json and <output>.csv" << std::endl
+              << "  --sweep <sweep.json>                                  with --ground-truth: evaluate all combinations of the" << std::endl
+              << "                                                        parameter ranges, write the results and the pareto front" << std::endl
+              << "                                                        to <output>.json and <output>.csv and the best config" << std::endl
+              << "                                                        to <output>.best.json" << std::endl;
+}
+
+BeesBookCommon::Stage parseStage(std::string const &name) {
+    static const std::map<std::string, BeesBookCommon::Stage> stages {
+        { "localizer",     BeesBookCommon::Stage::Localizer },
+        { "ellipsefitter", BeesBookCommon::Stage::EllipseFitter },
+        { "gridfitter",    BeesBookCommon::Stage::GridFitter },
+        { "decoder",       BeesBookCommon::Stage::Decoder }
+    };
+
+    const auto it = stages.find(name);
+    if (it == stages.end()) {
+        throw std::invalid_argument("unknown stage " + name);
+    }
+    return it->second;
+}
+}
+
+int main(int argc, char **argv) {
+    Batch::BatchOptions options;
+    std::vector<std::string> positional;
+    boost::optional<std::string> groundTruthPath;
+    boost::optional<std::string> sweepPath;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg(argv[i]);
+            const auto nextValue = [&]() {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("missing value for " + arg);
+                }
+                return std::string(argv[++i]);
+            };
+
+            if (arg == "-h" || arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--stage") {
+                options.lastStage = parseStage(nextValue());
+            } else if (arg == "--max-frames") {
+                options.maxFrames = boost::lexical_cast<size_t>(nextValue());
+            } else if (arg == "--input-format") {
+                options.inputFormat = FrameIngestion::parseFormat(nextValue());
+            } else if (arg == "--pipelined") {
+                options.mode = Batch::ExecutionMode::Pipelined;
+            } else if (arg == "--instances") {
+                options.mode = Batch::ExecutionMode::FrameParallel;
+                options.numInstances = boost::lexical_cast<size_t>(nextValue());
+            } else if (arg == "--queue-size") {
+                options.queueCapacity = boost::lexical_cast<size_t>(nextValue());
+            } else if (arg == "--threads") {
+                options.numThreads = boost::lexical_cast<size_t>(nextValue());
+            } else if (arg == "--tile-size") {
+                if (!options.tiling) {
+                    options.tiling.emplace();
+                }
+                options.tiling->tileSize = boost::lexical_cast<int>(nextValue());
+            } else if (arg == "--halo") {
+                if (!options.tiling) {
+                    options.tiling.emplace();
+                }
+                options.tiling->halo = boost::lexical_cast<int>(nextValue());
+            } else if (arg == "--tile-threads") {
+                if (!options.tiling) {
+                    options.tiling.emplace();
+                }
+                options.tiling->numThreads = boost::lexical_cast<size_t>(nextValue());
+            } else if (arg == "--checkpoint") {
+                options.checkpointDirectory = nextValue();
+            } else if (arg == "--resume") {
+                options.resumeStage = parseStage(nextValue());
+            } else if (arg == "--ground-truth") {
+                groundTruthPath = nextValue();
+            } else if (arg == "--sweep") {
+                sweepPath = nextValue();
+            } else if (arg.compare(0, 2, "--") == 0) {
+                throw std::invalid_argument("unknown option " + arg);
+            } else {
+                positional.push_back(arg);
+            }
+        }
+
+        if (positional.size() != 3) {
+            throw std::invalid_argument("expected config, input and output path");
+        }
+        if (sweepPath && !groundTruthPath) {
+            throw std::invalid_argument("--sweep requires --ground-truth");
+        }
+        if (options.resumeStage && options.checkpointDirectory.empty()) {
+            throw std::invalid_argument("--resume requires --checkpoint");
+        }
+        if (!options.checkpointDirectory.empty() && groundTruthPath) {
+            throw std::invalid_argument("--checkpoint can not be combined with --ground-truth");
+        }
+    } catch (std::exception const &e) {
+        std::cerr << "Error: " << e.what() << std::endl << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    options.configPath = positional[0];
+    options.inputPath  = positional[1];
+    options.outputPath = positional[2];
+
+    try {
+        if (sweepPath) {
+            Batch::SweepOptions sweepOptions;
+            sweepOptions.configPath      = options.configPath;
+            sweepOptions.sweepPath       = sweepPath.get();
+            sweepOptions.inputPath       = options.inputPath;
+            sweepOptions.groundTruthPath = groundTruthPath.get();
+            sweepOptions.outputPath      = options.outputPath;
+            sweepOptions.inputFormat     = options.inputFormat;
+            sweepOptions.maxFrames       = options.maxFrames;
+            sweepOptions.numInstances    = options.numInstances;
+            sweepOptions.queueCapacity   = options.queueCapacity;
+            sweepOptions.tiling          = options.tiling;
+
+            Batch::runSweep(sweepOptions, std::cerr);
+        } else if (groundTruthPath) {
+            Batch::EvaluationOptions evaluationOptions;
+            evaluationOptions.configPath      = options.configPath;
+            evaluationOptions.inputPath       = options.inputPath;
+            evaluationOptions.groundTruthPath = groundTruthPath.get();
+            evaluationOptions.outputPath      = options.outputPath;
+            evaluationOptions.inputFormat     = options.inputFormat;
+            evaluationOptions.maxFrames       = options.maxFrames;
+            evaluationOptions.numInstances    = options.numInstances;
+            evaluationOptions.queueCapacity   = options.queueCapacity;
+            evaluationOptions.numThreads      = options.numThreads;
+            evaluationOptions.tiling          = options.tiling;
+
+            Batch::runEvaluation(evaluationOptions, std::cerr);
+        } else {
+            Batch::runBatch(options, std::cerr);
+        }
+    } catch (std::exception const &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
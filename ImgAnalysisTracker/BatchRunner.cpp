@@ -0,0 +1,294 @@
+#include "BatchRunner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <stdexcept>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+
+#include <pipeline/datastructure/Tag.h>
+#include <pipeline/datastructure/TagCandidate.h>
+#include <pipeline/datastructure/PipelineGrid.h>
+
+#include "BinaryTaglist.h"
+#include "FrameBufferPool.h"
+#include "FrameIngestion.h"
+#include "FrameParallelPipeline.h"
+#include "PipelineInstance.h"
+#include "StageCheckpoint.h"
+#include "StagePipeline.h"
+
+using namespace BeesBookCommon;
+
+namespace Batch {
+
+namespace {
+bool isImageFile(boost::filesystem::path const &path) {
+    static const std::set<std::string> extensions { ".png", ".jpg", ".jpeg", ".tif", ".tiff", ".bmp", ".pgm" };
+
+    return boost::filesystem::is_regular_file(path) &&
+           extensions.count(boost::algorithm::to_lower_copy(path.extension().string()));
+}
+
+void logStatistics(std::vector<StagePipeline::StageStatistics> const &statistics, std::ostream &log) {
+    for (const StagePipeline::StageStatistics &stage : statistics) {
+        const QueueStatistics &queue = stage.inputQueue;
+        log << "  " << stage.name << ": " << stage.numFrames << " frames, busy " << stage.busyMs << "ms"
+            << " | input queue " << queue.size << "/" << queue.capacity
+            << " (max " << queue.maxSize << ", avg " << queue.averageSize << ")"
+            << ", producer stalled " << queue.pushStallMs << "ms"
+            << ", consumer stalled " << queue.popStallMs << "ms" << std::endl;
+    }
+}
+
+void logStatistics(std::vector<FrameParallelPipeline::InstanceStatistics> const &statistics, std::ostream &log) {
+    for (size_t idx = 0; idx < statistics.size(); ++idx) {
+        const FrameParallelPipeline::InstanceStatistics &instance = statistics[idx];
+        log << "  Instance " << idx << ": " << instance.numFrames << " frames, busy " << instance.busyMs << "ms"
+            << " | input queue max " << instance.inputQueue.maxSize << "/" << instance.inputQueue.capacity
+            << ", stalled " << instance.inputQueue.popStallMs << "ms"
+            << " | output queue max " << instance.outputQueue.maxSize << "/" << instance.outputQueue.capacity
+            << ", stalled " << instance.outputQueue.pushStallMs << "ms" << std::endl;
+    }
+}
+}
+
+FrameSource::FrameSource(const std::string &path, const bool rawFrames)
+    : _nextFrameNumber(0) {
+    if (boost::filesystem::is_directory(path)) {
+        for (boost::filesystem::directory_iterator it(path); it != boost::filesystem::directory_iterator(); ++it) {
+            if (isImageFile(it->path())) {
+                _imageFiles.push_back(it->path().string());
+            }
+        }
+        std::sort(_imageFiles.begin(), _imageFiles.end());
+    } else {
+        _capture.emplace(path);
+        if (!_capture->isOpened()) {
+            throw std::runtime_error("unable to open video " + path);
+        }
+        if (rawFrames) {
+            _capture->set(CV_CAP_PROP_CONVERT_RGB, 0.);
+        }
+    }
+}
+
+bool FrameSource::read(cv::Mat &frame) {
+    if (_capture) {
+        if (!_capture->read(frame) || frame.empty()) {
+            return false;
+        }
+    } else {
+        if (_nextFrameNumber >= _imageFiles.size()) {
+            return false;
+        }
+        frame = cv::imread(_imageFiles[_nextFrameNumber], cv::IMREAD_UNCHANGED);
+        if (frame.empty()) {
+            throw std::runtime_error("unable to read image " + _imageFiles[_nextFrameNumber]);
+        }
+    }
+
+    ++_nextFrameNumber;
+    return true;
+}
+
+bool FrameSource::skip() {
+    if (_capture) {
+        if (!_capture->grab()) {
+            return false;
+        }
+    } else if (_nextFrameNumber >= _imageFiles.size()) {
+        return false;
+    }
+
+    ++_nextFrameNumber;
+    return true;
+}
+
+CsvTaglistWriter::CsvTaglistWriter(const std::string &path)
+    : _stream(path) {
+    if (!_stream) {
+        throw std::runtime_error("unable to open output file " + path);
+    }
+    _stream << "frame,roi_x,roi_y,roi_width,roi_height,id,bits\n";
+}
+
+void CsvTaglistWriter::write(const size_t frameNumber, const taglist_t &taglist) {
+    for (const pipeline::Tag &tag : taglist) {
+        const cv::Rect &roi = tag.getRoi();
+        _stream << frameNumber << ',' << roi.x << ',' << roi.y << ',' << roi.width << ',' << roi.height << ',';
+
+        if (!tag.getCandidatesConst().empty() &&
+                !tag.getCandidatesConst()[0].getDecodings().empty()) {
+            const pipeline::decoding_t &decoding = tag.getCandidatesConst()[0].getDecodings()[0];
+            _stream << decoding.to_ulong() << ',' << decoding.to_string();
+        } else {
+            _stream << ',';
+        }
+        _stream << '\n';
+    }
+}
+
+std::unique_ptr<TaglistWriter> createTaglistWriter(const BatchOptions &options) {
+    if (boost::filesystem::path(options.outputPath).extension() == ".bbtags") {
+        return std::make_unique<BinaryTaglistWriter>(options.outputPath);
+    }
+    return std::make_unique<CsvTaglistWriter>(options.outputPath);
+}
+
+size_t runBatch(const BatchOptions &options, std::ostream &log) {
+    if (!options.checkpointDirectory.empty() && options.mode != ExecutionMode::Sequential) {
+        throw std::invalid_argument("checkpoints are only supported in sequential mode");
+    }
+    if (options.resumeStage && options.checkpointDirectory.empty()) {
+        throw std::invalid_argument("resuming requires a checkpoint directory");
+    }
+    if (options.resumeStage && options.resumeStage.get() >= options.lastStage) {
+        throw std::invalid_argument("there are no stages to run after the resumed stage");
+    }
+
+    const pipeline_settings_t settings = loadPipelineSettings(options.configPath);
+    const FrameIngestion ingestion(options.inputFormat);
+    FrameSource source(options.inputPath, ingestion.requiresRawFrames());
+    const std::unique_ptr<TaglistWriter> writer = createTaglistWriter(options);
+
+    // when resuming, the checkpoint directory is only read
+    std::unique_ptr<CheckpointReader> checkpoint;
+    std::unique_ptr<CheckpointWriter> checkpointWriter;
+    std::vector<size_t> checkpointFrames;
+    if (options.resumeStage) {
+        checkpoint = std::make_unique<CheckpointReader>(options.checkpointDirectory, options.resumeStage.get());
+        checkpointFrames = checkpoint->getFrameNumbers();
+        log << "Resuming " << checkpointFrames.size() << " frames from " << options.checkpointDirectory << std::endl;
+    } else if (!options.checkpointDirectory.empty()) {
+        checkpointWriter = std::make_unique<CheckpointWriter>(options.checkpointDirectory);
+    }
+
+    // frames and their grayscale versions are reused once all stages are done with them
+    FrameBufferPool bufferPool;
+    cv::Size frameSize;
+    int frameType = CV_8UC3;
+
+    size_t numRead = 0;
+    const auto readFrame = [&](size_t & frameNumber, cv::Mat & frameGray) {
+        if (options.maxFrames && numRead >= options.maxFrames.get()) {
+            return false;
+        }
+
+        // frames that are not in the checkpoint are skipped without decoding them
+        if (checkpoint) {
+            while (!checkpoint->hasFrame(source.getNextFrameNumber())) {
+                if (checkpointFrames.empty() || source.getNextFrameNumber() > checkpointFrames.back() ||
+                        !source.skip()) {
+                    return false;
+                }
+            }
+        }
+
+        cv::Mat frame;
+        if (source.isVideo() && frameSize.area() > 0) {
+            frame = bufferPool.acquire(frameSize, frameType);
+        }
+        if (!source.read(frame)) {
+            return false;
+        }
+        frameSize = frame.size();
+        frameType = frame.type();
+
+        frameNumber = source.getFrameNumber();
+        frameGray.release();
+        if (!ingestion.sharesBuffer(frame)) {
+            frameGray = bufferPool.acquire(frameSize, CV_8UC1);
+        }
+        ingestion.toGray(frame, frameGray);
+        ++numRead;
+
+        return true;
+    };
+
+    size_t numFrames = 0;
+    size_t numTags   = 0;
+    const auto writeResult = [&](size_t frameNumber, taglist_t const & taglist) {
+        writer->write(frameNumber, taglist);
+
+        ++numFrames;
+        numTags += taglist.size();
+
+        return options.logInterval && (numFrames % options.logInterval == 0);
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+
+    size_t frameNumber;
+    cv::Mat frameGray;
+    taglist_t taglist;
+
+    switch (options.mode) {
+    case ExecutionMode::Sequential: {
+        PipelineInstance pipeline(settings, options.numThreads, options.tiling);
+
+        PipelineInstance::stage_observer_t observer;
+        if (checkpointWriter) {
+            observer = [&](Stage stage, taglist_t const & stageTaglist) {
+                checkpointWriter->write(frameNumber, stage, stageTaglist);
+            };
+        }
+
+        while (readFrame(frameNumber, frameGray)) {
+            taglist = checkpoint ?
+                      pipeline.resume(checkpoint->read(frameNumber, frameGray), checkpoint->getStage(),
+                                      options.lastStage, observer) :
+                      pipeline.process(frameGray, options.lastStage, observer);
+            if (writeResult(frameNumber, taglist)) {
+                log << numFrames << " frames processed" << std::endl;
+            }
+        }
+        break;
+    }
+    case ExecutionMode::Pipelined: {
+        StagePipeline stagePipeline(settings, readFrame, options.lastStage, options.queueCapacity,
+                                    options.numThreads, options.tiling);
+        while (stagePipeline.pop(frameNumber, taglist)) {
+            if (writeResult(frameNumber, taglist)) {
+                log << numFrames << " frames processed" << std::endl;
+                logStatistics(stagePipeline.getStatistics(), log);
+            }
+        }
+        log << "Stage statistics:" << std::endl;
+        logStatistics(stagePipeline.getStatistics(), log);
+        break;
+    }
+    case ExecutionMode::FrameParallel: {
+        FrameParallelPipeline framePipeline(settings, readFrame, options.lastStage, options.numInstances,
+                                            options.queueCapacity, options.numThreads, options.tiling);
+        log << "Running " << framePipeline.getNumInstances() << " pipeline instances" << std::endl;
+        while (framePipeline.pop(frameNumber, taglist)) {
+            if (writeResult(frameNumber, taglist)) {
+                log << numFrames << " frames processed" << std::endl;
+            }
+        }
+        log << "Instance statistics:" << std::endl;
+        logStatistics(framePipeline.getStatistics(), log);
+        break;
+    }
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+
+    log << "Processed " << numFrames << " frames (" << numTags << " tags) in " << seconds << "s";
+    if (seconds > 0.) {
+        log << " (" << numFrames / seconds << " fps)";
+    }
+    log << std::endl;
+
+    const FrameBufferPool::Statistics pool = bufferPool.getStatistics();
+    log << "Frame buffer pool: " << pool.hits << " hits, " << pool.misses << " misses, "
+        << pool.numBuffers << " buffers, peak " << pool.peakBytes / (1024 * 1024) << " MiB" << std::endl;
+
+    return numFrames;
+}
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <opencv2/highgui/highgui.hpp>
+
+#include "Common.h"
+#include "FrameIngestion.h"
+#include "TiledLocalizer.h"
+
+namespace Batch {
+
+/**
+ * sequential frame source for headless processing, either a video file
+ * (or anything else cv::VideoCapture understands, e.g. "frame_%05d.png")
+ * or a directory of images that are read in lexicographical order
+ */
+class FrameSource {
+  public:
+    /**
+     * @param rawFrames ask the video backend not to convert frames to BGR (e.g. Bayer or 16 bit cameras)
+     */
+    explicit FrameSource(std::string const &path, bool rawFrames = false);
+
+    /**
+     * @param frame next frame as stored in the source
+     * @return false if there are no frames left
+     */
+    bool read(cv::Mat &frame);
+
+    /**
+     * advance to the next frame without decoding it
+     *
+     * @return false if there are no frames left
+     */
+    bool skip();
+
+    /**
+     * @return frame number of the frame returned by the last call to read()
+     */
+    size_t getFrameNumber() const { return _nextFrameNumber - 1; }
+
+    /**
+     * @return frame number of the frame returned by the next call to read()
+     */
+    size_t getNextFrameNumber() const { return _nextFrameNumber; }
+
+    /**
+     * @return true if frames are decoded into the buffer passed to read()
+     */
+    bool isVideo() const { return static_cast<bool>(_capture); }
+
+  private:
+    boost::optional<cv::VideoCapture> _capture;
+    std::vector<std::string> _imageFiles;
+    size_t _nextFrameNumber;
+};
+
+class TaglistWriter {
+  public:
+    virtual ~TaglistWriter() {}
+    virtual void write(size_t frameNumber, BeesBookCommon::taglist_t const &taglist) = 0;
+};
+
+/**
+ * one line per tag: frame number, ROI and (if decoded) the id of the best candidate
+ */
+class CsvTaglistWriter : public TaglistWriter {
+  public:
+    explicit CsvTaglistWriter(std::string const &path);
+    void write(size_t frameNumber, BeesBookCommon::taglist_t const &taglist) override;
+
+  private:
+    std::ofstream _stream;
+};
+
+enum class ExecutionMode : uint8_t {
+    // all stages of one frame after another on the calling thread
+    Sequential = 0,
+    // every stage on its own thread, see StagePipeline
+    Pipelined,
+    // whole frames on independent pipeline instances, see FrameParallelPipeline
+    FrameParallel
+};
+
+struct BatchOptions {
+    std::string configPath;
+    std::string inputPath;
+    std::string outputPath;
+    FrameFormat inputFormat = FrameFormat::Auto;
+    BeesBookCommon::Stage lastStage = BeesBookCommon::Stage::Decoder;
+    boost::optional<size_t> maxFrames;
+    ExecutionMode mode = ExecutionMode::Sequential;
+    size_t queueCapacity = 4;
+    // threads of the per-tag stages (0: number of hardware threads). With pipelined, they are
+    // split between the per-tag stages, which each run on their own pool
+    size_t numThreads = 1;
+    // pipeline instances in frame-parallel mode (0: number of hardware threads)
+    size_t numInstances = 0;
+    // split large frames into tiles for preprocessor and localizer
+    boost::optional<TilingOptions> tiling;
+    // interval (in frames) in which progress and queue statistics are logged
+    size_t logInterval = 100;
+    // the output of every executed stage is written to this directory, see StageCheckpoint.h.
+    // Only supported in sequential mode (empty: disabled)
+    std::string checkpointDirectory;
+    // replay: the output of this stage is read from the checkpoint directory and only the
+    // following stages are run. Frames that are not in the checkpoint are skipped
+    boost::optional<BeesBookCommon::Stage> resumeStage;
+};
+
+std::unique_ptr<TaglistWriter> createTaglistWriter(BatchOptions const &options);
+
+/**
+ * process all frames of options.inputPath and stream the results to options.outputPath
+ *
+ * @param options batch configuration
+ * @param log progress and timing messages are written to this stream
+ * @return number of processed frames
+ */
+size_t runBatch(BatchOptions const &options, std::ostream &log);
+
+}
@@ -20,14 +20,12 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/iostreams/device/file.hpp>
-#include <boost/archive/xml_iarchive.hpp>
 
 #include <pipeline/util/CvHelper.h>
 #include <pipeline/util/Util.h>
 #include <pipeline/datastructure/Tag.h>
 #include <pipeline/datastructure/TagCandidate.h>
 #include <pipeline/datastructure/PipelineGrid.h>
-#include <pipeline/datastructure/serialization.hpp>
 
 #include <groundtruth/converter.h>
 
@@ -47,7 +45,17 @@ using namespace Utils;
 
 BeesBookImgAnalysisTracker::BeesBookImgAnalysisTracker(BC::Settings &settings) :
     TrackingAlgorithm(settings),
-    _selectedStage(BeesBookCommon::Stage::NoProcessing) {
+    _selectedStage(BeesBookCommon::Stage::NoProcessing),
+    _tagStages(BeesBookCommon::getNumThreads(m_settings)),
+    _viewStages(BeesBookCommon::getNumThreads(m_settings)),
+    _groundTruthGeneration(0),
+    _groundTruthLoaded(false),
+    _lastFrameGeneration(0),
+    _resultFile(BeesBookCommon::getResultFile(m_settings)),
+    _checkpointDirectory(BeesBookCommon::getCheckpointDirectory(m_settings)),
+    _trackingWorker([this](bool busy) {
+        Q_EMIT trackingBusyChanged(busy);
+    }) {
     Ui::ToolWidget uiTools;
     uiTools.setupUi(&_toolsWidget);
 
@@ -103,11 +111,19 @@ BeesBookImgAnalysisTracker::BeesBookImgAnalysisTracker(BC::Settings &settings) :
     QObject::connect(uiTools.pushButtonLoadConfig, &QPushButton::pressed,
                      this, &BeesBookImgAnalysisTracker::loadConfig);
 
+    // the busy state is reported from the tracking thread
+    QObject::connect(this, &BeesBookImgAnalysisTracker::trackingBusyChanged,
+                     this, &BeesBookImgAnalysisTracker::onTrackingBusyChanged, Qt::QueuedConnection);
+
+    uiTools.spinBoxNumThreads->setValue(static_cast<int>(BeesBookCommon::getNumThreads(m_settings)));
+    QObject::connect(uiTools.spinBoxNumThreads, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+                     this, &BeesBookImgAnalysisTracker::numThreadsChanged);
+
     // load settings from config file
     _preprocessor.loadSettings(BeesBookCommon::getPreprocessorSettings(m_settings));
     _localizer.loadSettings(BeesBookCommon::getLocalizerSettings(m_settings));
-    _ellipsefitter.loadSettings(BeesBookCommon::getEllipseFitterSettings(m_settings));
-    _gridFitter.loadSettings(BeesBookCommon::getGridfitterSettings(m_settings));
+    _tagStages.loadSettings(BeesBookCommon::getEllipseFitterSettings(m_settings));
+    _tagStages.loadSettings(BeesBookCommon::getGridfitterSettings(m_settings));
 
     _biotrackerWidgetLayout.setContentsMargins(0, 0, 0, 0);
     _biotrackerWidgetLayout.setSpacing(0);
@@ -118,196 +134,522 @@ BeesBookImgAnalysisTracker::BeesBookImgAnalysisTracker(BC::Settings &settings) :
     getToolsWidget()->setLayout(&_biotrackerWidgetLayout);
 }
 
-void BeesBookImgAnalysisTracker::track(ulong /*frameNumber*/, const cv::Mat &frame) {
+void BeesBookImgAnalysisTracker::track(ulong frameNumber, const cv::Mat &frame) {
+    // only the grayscale frame is kept for the tracking thread. The frame buffer is
+    // owned by the caller, so it has to be copied if the conversion did not
     cv::Mat frameGray;
-    cv::cvtColor(frame, frameGray, CV_BGR2GRAY);
+    if (!_frameIngestion.sharesBuffer(frame)) {
+        frameGray = _bufferPool.acquire(frame.size(), CV_8UC1);
+    }
+    if (_frameIngestion.toGray(frame, frameGray)) {
+        frameGray = _bufferPool.clone(frameGray);
+    }
+    _lastFrame = BBTrackedFrame { frameNumber, frameGray, ++_lastFrameGeneration };
 
-    // notify lambda function
-    const auto notify =
-    [&](std::string const& message) {
-        Q_EMIT notifyGUI(message, BC::Messages::MessageType::NOTIFICATION);
-    };
+    // only the record of this frame is read from the loaded result file
+    if (_loadedResults && _loadedResults->hasFrame(frameNumber)) {
+        showLoadedResults(frameNumber);
+        return;
+    }
+
+    submitTracking(_lastFrame.get());
+}
+
+void BeesBookImgAnalysisTracker::submitTracking(const BBTrackedFrame &frame) {
+    const BeesBookCommon::Stage selectedStage = _selectedStage;
+
+    _trackingWorker.submit([ = ](CancellationToken const & cancellation) {
+        try {
+            runTracking(frame, selectedStage, cancellation);
+        } catch (CancelledException const &) {
+            throw;
+        } catch (std::exception const &e) {
+            Q_EMIT notifyGUI(std::string("Tracking failed: ") + e.what(), BC::Messages::MessageType::FAIL);
+        }
+    });
+}
+
+void BeesBookImgAnalysisTracker::runTracking(const BBTrackedFrame &frame,
+                                             const BeesBookCommon::Stage selectedStage,
+                                             const CancellationToken &cancellation) {
+    const ulong frameNumber  = frame.frameNumber;
+    const cv::Mat &frameGray = frame.frameGray;
 
     // acquire mutex (released when leaving function scope)
     const std::lock_guard<std::mutex> lock(_tagListLock);
 
-    // set wait cursor until end of track function
-    const CursorOverrideRAII cursorOverride(Qt::WaitCursor);
+    applyPendingSettings();
+    applyPendingGroundTruth();
+
+    // every call of track() invalidates all cached stage outputs, they are only reused
+    // when the same frame is tracked again
+    if (!_stageCache.frameGeneration || (_stageCache.frameGeneration.get() != frame.generation)) {
+        _stageCache.invalidate(BeesBookCommon::Stage::Preprocessor);
+        _stageCache.frameGeneration = frame.generation;
+        _stageCache.frameGray       = frameGray;
+    }
 
-    // invalidate previous visualizations (aka views)
-    for (boost::optional<cv::Mat> &visualization : _visualizationData.visualizations) {
-        visualization.reset();
+    // invalidate visualizations (aka views) of the stages that are recomputed
+    for (const BeesBookCommon::Stage stage : {
+                BeesBookCommon::Stage::Preprocessor,
+                BeesBookCommon::Stage::Localizer,
+                BeesBookCommon::Stage::EllipseFitter
+            }) {
+        if (!_stageCache.isValid(stage)) {
+            _visualizationData.reset(stage);
+            break;
+        }
     }
 
-    // taglist holds the tags found by the pipeline
-    _taglist.clear();
+    runStages(frameGray, selectedStage, cancellation);
 
-    // clear ground truth evaluation results
-    if (_groundTruthEvaluation) {
-        _groundTruthEvaluation.get().reset();
+    // the results of this run are collected in a new snapshot, painting keeps
+    // using the previous one until this one is complete
+    const std::shared_ptr<BBTrackingSnapshot> snapshot = std::make_shared<BBTrackingSnapshot>();
+    snapshot->results           = getStageResults(frameNumber, selectedStage);
+    snapshot->visualizationData = _visualizationData;
+    publishSnapshot(snapshot);
 
-        for (QLabel *label : {
-                    _groundTruthWidgets.labelNumFalsePositives,
-                    _groundTruthWidgets.labelNumTruePositives,
-                    _groundTruthWidgets.labelNumFalseNegatives,
-                    _groundTruthWidgets.labelNumPrecision,
-                    _groundTruthWidgets.labelNumRecall
-                }) {
-            label->setText("");
+    writeCheckpoint(frameNumber, selectedStage);
+
+    if (selectedStage == BeesBookCommon::Stage::Decoder) {
+        writeResults(snapshot->results);
+
+        if (snapshot->results->groundTruthCounts) {
+            addRunStatistics(snapshot->results->groundTruthCounts.get());
         }
     }
 
+    Q_EMIT update();
+}
+
+void BeesBookImgAnalysisTracker::runStages(const cv::Mat &frameGray, const BeesBookCommon::Stage selectedStage,
+                                           const CancellationToken &cancellation) {
+    // notify lambda function
+    const auto notify =
+    [&](std::string const& message) {
+        Q_EMIT notifyGUI(message, BC::Messages::MessageType::NOTIFICATION);
+    };
+
     // algorithm layer selection cascade
-    if (_selectedStage < BeesBookCommon::Stage::Preprocessor) {
+    cancellation.throwIfCancelled();
+    if (selectedStage < BeesBookCommon::Stage::Preprocessor) {
         return;
     }
 
-    // keep code in extra block for measuring execution time in RAII-fashion
-    pipeline::PreprocessorResult result;
-    {
+    if (!_stageCache.isValid(BeesBookCommon::Stage::Preprocessor)) {
         // start the clock
         MeasureTimeRAII measure("Preprocessor", notify);
 
         // process current frame and store result frame in _image
         // as of now this is a sobel filtered image further processed
-        result = _preprocessor.process(frameGray);
-        _image = result.originalImage;
+        _stageCache.preprocessorResult = _preprocessor.process(frameGray);
+        _stageCache.setValid(BeesBookCommon::Stage::Preprocessor);
+        _image = _stageCache.preprocessorResult.originalImage;
 
         // set preprocessor views
-        _visualizationData.preprocessorImage          = result.preprocessedImage;
-        _visualizationData.preprocessorClahe          = result.claheImage;
+        _visualizationData.preprocessorImage.setProducer([image = _stageCache.preprocessorResult.preprocessedImage]() {
+            return image;
+        });
+        _visualizationData.preprocessorClahe.setProducer([image = _stageCache.preprocessorResult.claheImage]() {
+            return image;
+        });
     }
 
     // end of preprocessor stage
-    if (_selectedStage < BeesBookCommon::Stage::Localizer) {
+    cancellation.throwIfCancelled();
+    if (selectedStage < BeesBookCommon::Stage::Localizer) {
         return;
     }
 
-    {
+    if (!_stageCache.isValid(BeesBookCommon::Stage::Localizer)) {
         // start the clock
         MeasureTimeRAII measure("Localizer", notify);
 
-        // process image, find ROIs with tags
-        _taglist = _localizer.process(std::move(result));
-
-        Q_EMIT notifyGUI(std::to_string(_taglist.size()));
+        // the localizer may modify its input, keep the cached preprocessor result untouched
+        pipeline::PreprocessorResult result = _stageCache.preprocessorResult;
+        result.originalImage     = _bufferPool.clone(result.originalImage);
+        result.preprocessedImage = _bufferPool.clone(result.preprocessedImage);
+        result.claheImage        = _bufferPool.clone(result.claheImage);
 
-        // set localizer views
-        _visualizationData.localizerInputImage     =  _image.clone();
-        _visualizationData.localizerBlobImage      = _localizer.getBlob().clone();
-        _visualizationData.localizerThresholdImage = _localizer.getThresholdImage().clone();
-
-        // evaluate localizer
-        if (_groundTruthEvaluation) {
-            _groundTruthEvaluation->evaluateLocalizer(getCurrentFrameNumber(), _taglist);
-        }
+        // process image, find ROIs with tags
+        _stageCache.localizerTaglist = _localizer.process(std::move(result));
+        _stageCache.setValid(BeesBookCommon::Stage::Localizer);
+
+        // set localizer views. The localizer overwrites its intermediate images when it
+        // processes the next frame while the snapshot may still be painted, keep a copy.
+        // The blob and threshold images are binary and mostly empty, they are kept run-length
+        // encoded and only decoded for their display conversion
+        _visualizationData.localizerInputImage.setProducer([image = _image]() {
+            return image;
+        });
+        _visualizationData.localizerBlobImage.setProducer([image = RleImage(_localizer.getBlob())]() {
+            return image.decode();
+        }, false);
+        _visualizationData.localizerThresholdImage.setProducer(
+        [image = RleImage(_localizer.getThresholdImage())]() {
+            return image.decode();
+        }, false);
     }
 
+    Q_EMIT notifyGUI(std::to_string(_stageCache.localizerTaglist.size()));
+
     // end of localizer stage
-    if (_selectedStage < BeesBookCommon::Stage::EllipseFitter) {
+    cancellation.throwIfCancelled();
+    if (selectedStage < BeesBookCommon::Stage::EllipseFitter) {
         return;
     }
 
-    {
+    if (!_stageCache.isValid(BeesBookCommon::Stage::EllipseFitter)) {
         // start the clock
-        MeasureTimeRAII measure("EllipseFitter", notify, _taglist.size());
+        MeasureTimeRAII measure("EllipseFitter", notify, _stageCache.localizerTaglist.size());
 
         // find ellipses in taglist
-        _taglist = _ellipsefitter.process(std::move(_taglist));
-
-        // set ellipsefitter views
-        // TODO: maybe only visualize areas with ROIs
-        _visualizationData.ellipsefitterCannyEdge = _ellipsefitter.computeCannyEdgeMap(frameGray);
-
-        // evaluate ellipsefitter
-        if (_groundTruthEvaluation) {
-            _groundTruthEvaluation->evaluateEllipseFitter(_taglist);
-        }
+        _stageCache.ellipsefitterTaglist = _tagStages.processEllipseFitter(taglist_t(_stageCache.localizerTaglist));
+        _stageCache.setValid(BeesBookCommon::Stage::EllipseFitter);
+
+        // set ellipsefitter views, only the tag ROIs are edge filtered
+        // computed by the GUI thread when painted, with its own copies of the stage objects.
+        // The settings the ellipsefitter used are captured, they may have changed by then
+        _visualizationData.ellipsefitterCannyEdge.setProducer(
+        [&viewStages = _viewStages, settings = _tagStages.getEllipseFitterSettings().get(),
+         tags = _stageCache.ellipsefitterTaglist, frameSize = frameGray.size()]() {
+            viewStages.loadSettings(settings);
+            return viewStages.computeCannyEdgeMap(tags, frameSize);
+        });
     }
 
     // end of ellipsefitter stage
-    if (_selectedStage < BeesBookCommon::Stage::GridFitter) {
+    cancellation.throwIfCancelled();
+    if (selectedStage < BeesBookCommon::Stage::GridFitter) {
         return;
     }
 
-    {
+    if (!_stageCache.isValid(BeesBookCommon::Stage::GridFitter)) {
         // start the clock
-        MeasureTimeRAII measure("GridFitter", notify, _taglist.size());
+        MeasureTimeRAII measure("GridFitter", notify, _stageCache.ellipsefitterTaglist.size());
 
         // fit grids to the ellipses found
-        _taglist = _gridFitter.process(std::move(_taglist));
-
-        // evaluate grids
-        if (_groundTruthEvaluation) {
-            _groundTruthEvaluation->evaluateGridFitter();
-        }
+        _stageCache.gridfitterTaglist = _tagStages.processGridFitter(taglist_t(_stageCache.ellipsefitterTaglist));
+        _stageCache.setValid(BeesBookCommon::Stage::GridFitter);
     }
 
     // end of gridfitter stage
-    if (_selectedStage < BeesBookCommon::Stage::Decoder) {
+    cancellation.throwIfCancelled();
+    if (selectedStage < BeesBookCommon::Stage::Decoder) {
         return;
     }
 
-    {
+    if (!_stageCache.isValid(BeesBookCommon::Stage::Decoder)) {
         // start the clock
-        MeasureTimeRAII measure("Decoder", notify, _taglist.size());
+        MeasureTimeRAII measure("Decoder", notify, _stageCache.gridfitterTaglist.size());
 
         // decode grids that were matched to the image
-        _taglist = _decoder.process(std::move(_taglist));
+        _stageCache.decoderTaglist = _tagStages.processDecoder(taglist_t(_stageCache.gridfitterTaglist));
+        _stageCache.setValid(BeesBookCommon::Stage::Decoder);
+    }
+}
+
+void BeesBookImgAnalysisTracker::addRunStatistics(const Batch::FrameEvaluation &frame) {
+    // a frame that is tracked again replaces its previous results
+    const size_t numFrames = _runStatistics.getNumFrames();
+    _runStatistics.add(frame);
+
+    if (_runStatistics.getNumFrames() > numFrames && _runStatistics.getNumFrames() % RUN_STATISTICS_INTERVAL == 0) {
+        Q_EMIT notifyGUI(_runStatistics.format(), BC::Messages::MessageType::NOTIFICATION);
+    }
+}
+
+void BeesBookImgAnalysisTracker::writeResults(const std::shared_ptr<const BBStageResults> &results) {
+    if (_resultFile.empty() || results == _writtenResults) {
+        return;
+    }
+
+    try {
+        // opened on first use, an existing file is continued
+        if (!_resultWriter) {
+            _resultWriter = std::make_unique<Batch::BinaryTaglistWriter>(_resultFile);
+        }
+        _resultWriter->write(results->frameNumber, results->taglist);
+        _writtenResults = results;
+    } catch (std::exception const &e) {
+        Q_EMIT notifyGUI("Unable to write results to " + _resultFile + ": " + e.what(),
+                         BC::Messages::MessageType::FAIL);
+        _resultWriter.reset();
+        _resultFile.clear();
+    }
+}
+
+void BeesBookImgAnalysisTracker::writeCheckpoint(const size_t frameNumber, const BeesBookCommon::Stage selectedStage) {
+    if (_checkpointDirectory.empty()) {
+        return;
+    }
+
+    try {
+        if (!_checkpointWriter) {
+            _checkpointWriter = std::make_unique<Batch::CheckpointWriter>(_checkpointDirectory);
+        }
+
+        for (const auto &stage : {
+                    std::make_pair(BeesBookCommon::Stage::Localizer, &_stageCache.localizerTaglist),
+                    std::make_pair(BeesBookCommon::Stage::EllipseFitter, &_stageCache.ellipsefitterTaglist),
+                    std::make_pair(BeesBookCommon::Stage::GridFitter, &_stageCache.gridfitterTaglist),
+                    std::make_pair(BeesBookCommon::Stage::Decoder, &_stageCache.decoderTaglist)
+                }) {
+            if (stage.first > selectedStage) {
+                break;
+            }
+
+            // an output is only written again if it has been recomputed
+            size_t &writtenOutputId = _checkpointOutputIds[static_cast<size_t>(stage.first)];
+            const size_t outputId   = _stageCache.getOutputId(stage.first);
+            if (outputId == writtenOutputId) {
+                continue;
+            }
 
-        // evaluate decodings
-        if (_groundTruthEvaluation) {
-            _groundTruthEvaluation->evaluateDecoder();
+            _checkpointWriter->write(frameNumber, stage.first, *stage.second);
+            writtenOutputId = outputId;
         }
+    } catch (std::exception const &e) {
+        Q_EMIT notifyGUI("Unable to write checkpoint to " + _checkpointDirectory + ": " + e.what(),
+                         BC::Messages::MessageType::FAIL);
+        _checkpointWriter.reset();
+        _checkpointDirectory.clear();
+    }
+}
+
+std::shared_ptr<const BBStageResults> BeesBookImgAnalysisTracker::getStageResults(
+    const size_t frameNumber, const BeesBookCommon::Stage stage) {
+    // the results of a stage only change if its output or the ground truth has changed
+    const size_t outputId = _stageCache.getOutputId(stage);
+    const auto cached = _resultsCache.find(stage);
+    if ((cached != _resultsCache.end()) && (cached->second->frameNumber == frameNumber) &&
+            (cached->second->outputId == outputId) &&
+            (cached->second->groundTruthGeneration == _groundTruthGeneration)) {
+        return cached->second;
+    }
+
+    const std::shared_ptr<BBStageResults> results = std::make_shared<BBStageResults>();
+    results->stage                 = stage;
+    results->frameNumber           = frameNumber;
+    results->outputId              = outputId;
+    results->groundTruthGeneration = _groundTruthGeneration;
+
+    if (stage >= BeesBookCommon::Stage::Localizer) {
+        results->localizerTaglist = _stageCache.localizerTaglist;
+    }
+    switch (stage) {
+    case BeesBookCommon::Stage::Localizer:
+        results->taglist = _stageCache.localizerTaglist;
+        break;
+    case BeesBookCommon::Stage::EllipseFitter:
+        results->taglist = _stageCache.ellipsefitterTaglist;
+        break;
+    case BeesBookCommon::Stage::GridFitter:
+        results->taglist = _stageCache.gridfitterTaglist;
+        break;
+    case BeesBookCommon::Stage::Decoder:
+        results->taglist = _stageCache.decoderTaglist;
+        break;
+    default:
+        break;
+    }
+
+    // the stages are evaluated up to the requested one
+    evaluateGroundTruth(*results);
+
+    _resultsCache[stage] = results;
+    return results;
+}
+
+void BeesBookImgAnalysisTracker::applyPendingSettings() {
+    boost::optional<BeesBookCommon::pipeline_settings_t> settings;
+    std::set<BeesBookCommon::Stage> stages;
+    boost::optional<size_t> numThreads;
+
+    {
+        const std::lock_guard<std::mutex> lock(_pendingSettingsLock);
+        std::swap(settings, _pendingSettings);
+        std::swap(stages, _pendingSettingsStages);
+        std::swap(numThreads, _pendingNumThreads);
+    }
+
+    if (numThreads) {
+        _tagStages.setNumThreads(numThreads.get());
+    }
+
+    if (!settings || stages.empty()) {
+        return;
+    }
+
+    for (const BeesBookCommon::Stage stage : stages) {
+        switch (stage) {
+        case BeesBookCommon::Stage::Preprocessor:
+            _preprocessor.loadSettings(settings->preprocessor);
+            break;
+        case BeesBookCommon::Stage::Localizer:
+            _localizer.loadSettings(settings->localizer);
+            break;
+        case BeesBookCommon::Stage::EllipseFitter:
+            _tagStages.loadSettings(settings->ellipsefitter);
+            break;
+        case BeesBookCommon::Stage::GridFitter:
+            _tagStages.loadSettings(settings->gridfitter);
+            break;
+        case BeesBookCommon::Stage::Decoder:
+            // TODO
+            break;
+        default:
+            break;
+        }
+    }
+
+    // std::set is ordered, resume from the first stage whose settings changed
+    _stageCache.invalidate(*stages.begin());
+
+    // the statistics refer to a single configuration
+    _runStatistics.reset();
+}
+
+void BeesBookImgAnalysisTracker::applyPendingGroundTruth() {
+    std::shared_ptr<const GroundTruthCache> groundTruthCache;
+
+    {
+        const std::lock_guard<std::mutex> lock(_pendingSettingsLock);
+        std::swap(groundTruthCache, _pendingGroundTruth);
+    }
+
+    if (!groundTruthCache) {
+        return;
+    }
+
+    _groundTruthCache = groundTruthCache;
+    ++_groundTruthGeneration;
+    _resultsCache.clear();
+    _runStatistics.reset();
+}
+
+std::shared_ptr<const BBTrackingSnapshot> BeesBookImgAnalysisTracker::getSnapshot() const {
+    return std::atomic_load(&_snapshot);
+}
+
+void BeesBookImgAnalysisTracker::publishSnapshot(std::shared_ptr<const BBTrackingSnapshot> snapshot) {
+    std::atomic_store(&_snapshot, std::move(snapshot));
+}
+
+void BeesBookImgAnalysisTracker::evaluateGroundTruth(BBStageResults &results) const {
+    if (!_groundTruthCache || results.stage < BeesBookCommon::Stage::Localizer) {
+        return;
+    }
+
+    // only the annotations of the frame are decoded. The evaluation keeps references to the
+    // tags, the results must not be copied afterwards
+    results.groundTruthEvaluation.emplace(
+        gtConverter::ResultsFromSerializationData(*_groundTruthCache->getFrame(results.frameNumber)));
+    GroundTruthEvaluation &evaluation = results.groundTruthEvaluation.get();
+
+    evaluation.evaluateLocalizer(results.frameNumber, results.localizerTaglist);
+    if (results.stage >= BeesBookCommon::Stage::EllipseFitter) {
+        evaluation.evaluateEllipseFitter(results.taglist);
+    }
+    if (results.stage >= BeesBookCommon::Stage::GridFitter) {
+        evaluation.evaluateGridFitter();
     }
+    if (results.stage >= BeesBookCommon::Stage::Decoder) {
+        evaluation.evaluateDecoder();
+    }
+
+    results.groundTruthCounts.emplace();
+    results.groundTruthCounts->frameNumber = results.frameNumber;
+    Batch::countEvaluation(evaluation, results.groundTruthCounts.get());
+}
+
+void BeesBookImgAnalysisTracker::publishTaglist(const size_t frameNumber, taglist_t taglist) {
+    const std::shared_ptr<const BBTrackingSnapshot> current = getSnapshot();
+
+    // a loaded taglist holds the output of all stages
+    const std::shared_ptr<BBStageResults> results = std::make_shared<BBStageResults>();
+    results->stage            = BeesBookCommon::Stage::Decoder;
+    results->frameNumber      = frameNumber;
+    results->loaded           = true;
+    results->taglist          = std::move(taglist);
+    results->localizerTaglist = results->taglist;
+    evaluateGroundTruth(*results);
+
+    const std::shared_ptr<BBTrackingSnapshot> snapshot = std::make_shared<BBTrackingSnapshot>();
+    snapshot->results = results;
+    if (current) {
+        snapshot->visualizationData = current->visualizationData;
+    }
+
+    publishSnapshot(snapshot);
+
+    Q_EMIT update();
 }
 
-void BeesBookImgAnalysisTracker::visualizeLocalizerOutputOverlay(QPainter *painter) const {
-    QPen pen = getDefaultPen(painter);
+void BeesBookImgAnalysisTracker::showLoadedResults(const size_t frameNumber) {
+    // the frame is read and published by the tracking thread, the GUI thread never waits for
+    // a running job. The reader is kept alive even if the results are unloaded meanwhile
+    const std::shared_ptr<const Batch::BinaryTaglistReader> loadedResults = _loadedResults;
+
+    _trackingWorker.submit([ = ](CancellationToken const &) {
+        try {
+            taglist_t taglist = loadedResults->read(frameNumber);
+
+            const std::lock_guard<std::mutex> lock(_tagListLock);
+            applyPendingGroundTruth();
+            publishTaglist(frameNumber, std::move(taglist));
+        } catch (std::exception const &e) {
+            Q_EMIT notifyGUI("Unable to load taglist of frame " + std::to_string(frameNumber) + ": " + e.what(),
+                             BC::Messages::MessageType::FAIL);
+        }
+    });
+}
 
+void BeesBookImgAnalysisTracker::onTrackingBusyChanged(bool busy) {
+    if (!busy) {
+        _busyCursor.reset();
+        return;
+    }
+
+    if (!_busyCursor) {
+        _busyCursor.emplace(Qt::BusyCursor);
+    }
+}
+
+void BeesBookImgAnalysisTracker::visualizeLocalizerOutputOverlay(BBStageResults const &stageResults, OverlayBatch &overlay) const {
     // if there is no ground truth, draw all
     // pipeline ROIs in blue and return
-    if (!_groundTruthEvaluation) {
-        for (const pipeline::Tag &tag : _taglist) {
-            pen.setColor(QCOLOR_LIGHT_BLUE);
-            drawBox(tag.getRoi(), painter, pen);
+    if (!stageResults.groundTruthEvaluation) {
+        for (const pipeline::Tag &tag : stageResults.taglist) {
+            overlay.addBox(tag.getRoi(), QCOLOR_LIGHT_BLUE);
         }
         return;
     }
 
     // ... GT available, that means localizer has been evaluated (localizerResults holds data)
     // get localizer results struct
-    const GroundTruth::LocalizerEvaluationResults &results = _groundTruthEvaluation->getLocalizerResults();
+    const GroundTruth::LocalizerEvaluationResults &results = stageResults.groundTruthEvaluation->getLocalizerResults();
 
     // correctly found
     for (const pipeline::Tag &tag : results.truePositives) {
-        pen.setColor(QCOLOR_GREEN);
-        drawBox(tag.getRoi(), painter, pen);
+        overlay.addBox(tag.getRoi(), QCOLOR_GREEN);
     }
 
     // false detections
     for (const pipeline::Tag &tag : results.falsePositives) {
-        pen.setColor(QCOLOR_RED);
-        drawBox(tag.getRoi(), painter, pen);
+        overlay.addBox(tag.getRoi(), QCOLOR_RED);
     }
 
     // missing detections
     for (const std::shared_ptr<PipelineGrid> &grid : results.falseNegatives) {
-        pen.setColor(QCOLOR_ORANGE);
-        drawBox(grid->getBoundingBox(), painter, pen);
+        overlay.addBox(grid->getBoundingBox(), QCOLOR_ORANGE);
     }
-
-    const size_t numGroundTruth    = results.taggedGridsOnFrame.size();
-    const size_t numTruePositives  = results.truePositives.size();
-    const size_t numFalsePositives = results.falsePositives.size();
-    const size_t numFalseNegatives = results.falseNegatives.size();
-
-    _groundTruthWidgets.setResults(numGroundTruth, numTruePositives, numFalsePositives, numFalseNegatives);
 }
 
-void BeesBookImgAnalysisTracker::visualizeEllipseFitterOutput(cv::Mat &image) const {
-    if (_groundTruthEvaluation) {
-        const GroundTruth::EllipseFitterEvaluationResults &results = _groundTruthEvaluation->getEllipsefitterResults();
+void BeesBookImgAnalysisTracker::visualizeEllipseFitterOutput(BBStageResults const &stageResults, cv::Mat &image) const {
+    if (stageResults.groundTruthEvaluation) {
+        const GroundTruth::EllipseFitterEvaluationResults &results = stageResults.groundTruthEvaluation->getEllipsefitterResults();
 
         for (const std::shared_ptr<PipelineGrid> &grid : results.falseNegatives) {
             grid->drawContours(image, 1.0);
@@ -315,36 +657,28 @@ void BeesBookImgAnalysisTracker::visualizeEllipseFitterOutput(cv::Mat &image) co
     }
 }
 
-void BeesBookImgAnalysisTracker::visualizeEllipseFitterOutputOverlay(QPainter *painter) const {
-    QPen pen = getDefaultPen(painter);
-
-    if (!_groundTruthEvaluation) {
-        for (const pipeline::Tag &tag : _taglist) {
+void BeesBookImgAnalysisTracker::visualizeEllipseFitterOutputOverlay(BBStageResults const &stageResults, OverlayBatch &overlay) const {
+    if (!stageResults.groundTruthEvaluation) {
+        for (const pipeline::Tag &tag : stageResults.taglist) {
             if (!tag.getCandidatesConst().empty()) {
                 // get best candidate
                 const pipeline::TagCandidate &candidate = tag.getCandidatesConst()[0];
                 const pipeline::Ellipse &ellipse = candidate.getEllipse();
 
-                pen.setColor(QCOLOR_LIGHT_BLUE);
-                painter->setPen(pen);
-
-                drawEllipse(tag, pen, painter, ellipse);
+                overlay.addEllipse(tag, ellipse, QCOLOR_LIGHT_BLUE);
             }
         }
         return;
     }
 
-    const GroundTruth::EllipseFitterEvaluationResults &results = _groundTruthEvaluation->getEllipsefitterResults();
+    const GroundTruth::EllipseFitterEvaluationResults &results = stageResults.groundTruthEvaluation->getEllipsefitterResults();
 
     for (const auto &tagCandidatePair : results.truePositives) {
         const pipeline::Tag &tag = tagCandidatePair.first;
         const pipeline::TagCandidate &candidate = tagCandidatePair.second;
         const pipeline::Ellipse &ellipse = candidate.getEllipse();
 
-        pen.setColor(QCOLOR_GREEN);
-        painter->setPen(pen);
-
-        drawEllipse(tag, pen, painter, ellipse);
+        overlay.addEllipse(tag, ellipse, QCOLOR_GREEN);
     }
 
     for (const pipeline::Tag &tag : results.falsePositives) {
@@ -353,30 +687,18 @@ void BeesBookImgAnalysisTracker::visualizeEllipseFitterOutputOverlay(QPainter *p
             const pipeline::Ellipse &ellipse =
                 tag.getCandidatesConst().at(0).getEllipse();
 
-            pen.setColor(QCOLOR_RED);
-            painter->setPen(pen);
-
-            drawEllipse(tag, pen, painter, ellipse);
+            overlay.addEllipse(tag, ellipse, QCOLOR_RED);
         }
     }
 
     for (const std::shared_ptr<PipelineGrid> &grid : results.falseNegatives) {
-        pen.setColor(QCOLOR_ORANGE);
-
-        drawBox(grid->getBoundingBox(), painter, pen);
+        overlay.addBox(grid->getBoundingBox(), QCOLOR_ORANGE);
     }
-
-    const size_t numGroundTruth    = results.taggedGridsOnFrame.size();
-    const size_t numTruePositives  = results.truePositives.size();
-    const size_t numFalsePositives = results.falsePositives.size();
-    const size_t numFalseNegatives = results.falseNegatives.size();
-
-    _groundTruthWidgets.setResults(numGroundTruth, numTruePositives, numFalsePositives, numFalseNegatives);
 }
 
-void BeesBookImgAnalysisTracker::visualizeGridFitterOutput(cv::Mat &image) const {
-    if (!_groundTruthEvaluation) {
-        for (const pipeline::Tag &tag : _taglist) {
+void BeesBookImgAnalysisTracker::visualizeGridFitterOutput(BBStageResults const &stageResults, cv::Mat &image) const {
+    if (!stageResults.groundTruthEvaluation) {
+        for (const pipeline::Tag &tag : stageResults.taglist) {
             if (!tag.getCandidatesConst().empty()) {
 
                 if (! tag.getCandidatesConst().empty()) {
@@ -393,7 +715,7 @@ void BeesBookImgAnalysisTracker::visualizeGridFitterOutput(cv::Mat &image) const
         return;
     }
 
-    const GroundTruth::GridFitterEvaluationResults &results = _groundTruthEvaluation->getGridfitterResults();
+    const GroundTruth::GridFitterEvaluationResults &results = stageResults.groundTruthEvaluation->getGridfitterResults();
 
     for (const PipelineGrid &pipegrid : results.truePositives) {
         pipegrid.drawContours(image, 0.5);
@@ -419,11 +741,9 @@ QPen BeesBookImgAnalysisTracker::getDefaultPen(QPainter *painter) {
     return pen;
 }
 
-void BeesBookImgAnalysisTracker::visualizeGridFitterOutputOverlay(QPainter *painter) const {
-    QPen pen = getDefaultPen(painter);
-
-    if (!_groundTruthEvaluation) {
-        for (const pipeline::Tag &tag : _taglist) {
+void BeesBookImgAnalysisTracker::visualizeGridFitterOutputOverlay(BBStageResults const &stageResults, OverlayBatch &overlay) const {
+    if (!stageResults.groundTruthEvaluation) {
+        for (const pipeline::Tag &tag : stageResults.taglist) {
             if (!tag.getCandidatesConst().empty()) {
 
                 if (! tag.getCandidatesConst().empty()) {
@@ -432,9 +752,7 @@ void BeesBookImgAnalysisTracker::visualizeGridFitterOutputOverlay(QPainter *pain
 
                     if (! candidate.getGridsConst().empty()) {
                         const PipelineGrid &grid = candidate.getGridsConst()[0];
-                        pen.setColor(QCOLOR_LIGHT_BLUE);
-
-                        drawBox(grid.getBoundingBox(), painter, pen);
+                        overlay.addBox(grid.getBoundingBox(), QCOLOR_LIGHT_BLUE);
                     }
                 }
             }
@@ -442,37 +760,24 @@ void BeesBookImgAnalysisTracker::visualizeGridFitterOutputOverlay(QPainter *pain
         return;
     }
 
-    const GroundTruth::GridFitterEvaluationResults &results = _groundTruthEvaluation->getGridfitterResults();
+    const GroundTruth::GridFitterEvaluationResults &results = stageResults.groundTruthEvaluation->getGridfitterResults();
 
     for (const PipelineGrid &pipegrid : results.truePositives) {
-        pen.setColor(QCOLOR_GREEN);
-
-        drawBox((pipegrid.getBoundingBox() + cv::Size(20, 20)) - cv::Point(10, 10), painter, pen);
+        overlay.addBox((pipegrid.getBoundingBox() + cv::Size(20, 20)) - cv::Point(10, 10), QCOLOR_GREEN);
     }
 
     for (const PipelineGrid &pipegrid : results.falsePositives) {
-        pen.setColor(QCOLOR_RED);
-
-        drawBox((pipegrid.getBoundingBox() + cv::Size(20, 20)) - cv::Point(10, 10), painter, pen);
+        overlay.addBox((pipegrid.getBoundingBox() + cv::Size(20, 20)) - cv::Point(10, 10), QCOLOR_RED);
     }
 
     for (const GroundTruthGridSPtr &grid : results.falseNegatives) {
-        pen.setColor(QCOLOR_ORANGE);
-
-        drawBox((grid->getBoundingBox() + cv::Size(20, 20)) - cv::Point(10, 10), painter, pen);
+        overlay.addBox((grid->getBoundingBox() + cv::Size(20, 20)) - cv::Point(10, 10), QCOLOR_ORANGE);
     }
-
-    const size_t numGroundTruth    = _groundTruthEvaluation->getEllipsefitterResults().taggedGridsOnFrame.size();
-    const size_t numTruePositives  = results.truePositives.size();
-    const size_t numFalsePositives = results.falsePositives.size();
-    const size_t numFalseNegatives = results.falseNegatives.size();
-
-    _groundTruthWidgets.setResults(numGroundTruth, numTruePositives, numFalsePositives, numFalseNegatives);
 }
 
-void BeesBookImgAnalysisTracker::visualizeDecoderOutput(cv::Mat &image) const {
-    if (!_groundTruthEvaluation) {
-        for (const pipeline::Tag &tag : _taglist) {
+void BeesBookImgAnalysisTracker::visualizeDecoderOutput(BBStageResults const &stageResults, cv::Mat &image) const {
+    if (!stageResults.groundTruthEvaluation) {
+        for (const pipeline::Tag &tag : stageResults.taglist) {
             if (!tag.getCandidatesConst().empty()) {
                 const pipeline::TagCandidate &candidate = tag.getCandidatesConst()[0];
                 if (candidate.getDecodings().size()) {
@@ -486,9 +791,9 @@ void BeesBookImgAnalysisTracker::visualizeDecoderOutput(cv::Mat &image) const {
     }
 
     const GroundTruth::EllipseFitterEvaluationResults &ellipseFitterResults =
-        _groundTruthEvaluation->getEllipsefitterResults();
+        stageResults.groundTruthEvaluation->getEllipsefitterResults();
     const GroundTruth::DecoderEvaluationResults &results =
-        _groundTruthEvaluation->getDecoderResults();
+        stageResults.groundTruthEvaluation->getDecoderResults();
 
     for (const GroundTruth::DecoderEvaluationResults::result_t &result : results.evaluationResults) {
         result.pipelineGrid.get().drawContours(image, 0.5);
@@ -499,13 +804,11 @@ void BeesBookImgAnalysisTracker::visualizeDecoderOutput(cv::Mat &image) const {
     }
 }
 
-void BeesBookImgAnalysisTracker::visualizeDecoderOutputOverlay(QPainter *painter) const {
+void BeesBookImgAnalysisTracker::visualizeDecoderOutputOverlay(BBStageResults const &stageResults, OverlayBatch &overlay) const {
     static const int distance      = 10;
 
-    QPen pen = getDefaultPen(painter);
-
-    if (!_groundTruthEvaluation) {
-        for (const pipeline::Tag &tag : _taglist) {
+    if (!stageResults.groundTruthEvaluation) {
+        for (const pipeline::Tag &tag : stageResults.taglist) {
             if (!tag.getCandidatesConst().empty()) {
                 const pipeline::TagCandidate &candidate = tag.getCandidatesConst()[0];
                 if (candidate.getDecodings().size()) {
@@ -520,15 +823,12 @@ void BeesBookImgAnalysisTracker::visualizeDecoderOutputOverlay(QPainter *painter
 
                     const QString idString = QString::fromStdString(decoding.to_string());
 
-                    pen.setColor(QCOLOR_LIGHT_BLUE);
+                    overlay.addBox((grid.getBoundingBox() + cv::Size(20, 20)) - cv::Point(10, 10), QCOLOR_LIGHT_BLUE);
 
-                    drawBox((grid.getBoundingBox() + cv::Size(20, 20)) - cv::Point(10, 10), painter, pen);
-
-                    painter->setPen(pen);
-                    painter->drawText(QPoint(tag.getRoi().x, tag.getRoi().y - distance -5),
-                                      QString::number(decoding.to_ulong()));
-                    painter->drawText(QPoint(tag.getRoi().x, tag.getRoi().y-5),
-                                      idString);
+                    overlay.addText(QPoint(tag.getRoi().x, tag.getRoi().y - distance -5),
+                                    QString::number(decoding.to_ulong()), QCOLOR_LIGHT_BLUE);
+                    overlay.addText(QPoint(tag.getRoi().x, tag.getRoi().y-5),
+                                    idString, QCOLOR_LIGHT_BLUE);
                 }
             }
         }
@@ -536,200 +836,206 @@ void BeesBookImgAnalysisTracker::visualizeDecoderOutputOverlay(QPainter *painter
     }
 
     const GroundTruth::EllipseFitterEvaluationResults &ellipseFitterResults =
-        _groundTruthEvaluation->getEllipsefitterResults();
+        stageResults.groundTruthEvaluation->getEllipsefitterResults();
     const GroundTruth::DecoderEvaluationResults &results =
-        _groundTruthEvaluation->getDecoderResults();
-
-    int matchNum           = 0;
-    int partialMismatchNum = 0;
-    int mismatchNum        = 0;
-    int cumulHamming       = 0;
+        stageResults.groundTruthEvaluation->getDecoderResults();
 
     for (const GroundTruth::DecoderEvaluationResults::result_t &result : results.evaluationResults) {
-        // calculate stats
         QColor color;
-        static const int threshold = 3;
         if (result.hammingDistance == 0) { // match
-            ++matchNum;
             color = QCOLOR_GREEN;
-        } else if (result.hammingDistance <= threshold) { // partial match
-            ++partialMismatchNum;
+        } else if (result.hammingDistance <= Batch::DecoderCounts::PARTIAL_MATCH_THRESHOLD) { // partial match
             color = QCOLOR_GREENISH;
         } else { // mismatch
-            ++mismatchNum;
             color = QCOLOR_RED;
         }
-        cumulHamming = cumulHamming + result.hammingDistance;
 
-        pen.setColor(color);
-        drawBox(result.boundingBox, painter, pen);
+        overlay.addBox(result.boundingBox, color);
 
         const int xpos = result.boundingBox.tl().x;
         const int ypos = result.boundingBox.tl().y;
         // paint text on image
 
-        painter->setPen(pen);
-        painter->drawText(QPoint(xpos, ypos - (distance * 2)-5),
-                          QString::number(result.decodedTagId)+", d=" + QString::number(result.hammingDistance));
-        painter->drawText(QPoint(xpos, ypos - distance -5),
-                          "rs: " + QString::fromStdString(result.decodedTagIdStr));
-        painter->drawText(QPoint(xpos, ypos-5),
-                          "gt: " + QString::fromStdString(result.groundTruthTagIdStr));
+        overlay.addText(QPoint(xpos, ypos - (distance * 2)-5),
+                        QString::number(result.decodedTagId)+", d=" + QString::number(result.hammingDistance), color);
+        overlay.addText(QPoint(xpos, ypos - distance -5),
+                        "rs: " + QString::fromStdString(result.decodedTagIdStr), color);
+        overlay.addText(QPoint(xpos, ypos-5),
+                        "gt: " + QString::fromStdString(result.groundTruthTagIdStr), color);
     }
 
     for (const GroundTruthGridSPtr &grid : ellipseFitterResults.falseNegatives) {
-        pen.setColor(QCOLOR_ORANGE);
-        drawBox(grid->getBoundingBox(), painter, pen);
+        overlay.addBox(grid->getBoundingBox(), QCOLOR_ORANGE);
     }
+}
 
-    const size_t numResults = results.evaluationResults.size();
+void BeesBookImgAnalysisTracker::showGroundTruthCounts(BBStageResults const &stageResults) const {
+    if (!_groundTruthLoaded) {
+        return;
+    }
 
-    const double avgHamming = numResults ? static_cast<double>(cumulHamming) / numResults : 0.;
-    const double precMatch  = numResults ? (static_cast<double>(matchNum) / static_cast<double>(numResults)) * 100.: 0.;
-    const double precPartly = numResults ? (static_cast<double>(matchNum + partialMismatchNum) / static_cast<double>
-                                            (numResults)) * 100. : 0.;
+    // stages after the evaluated ones have not been counted
+    const boost::optional<Batch::FrameEvaluation> &counts = stageResults.groundTruthCounts;
+    const bool evaluated = counts && stageResults.stage >= _selectedStage;
 
-    // statistics
-    _groundTruthWidgets.labelFalsePositives->setText("Match: ");
-    _groundTruthWidgets.labelNumFalsePositives->setText(QString::number(matchNum));
-    _groundTruthWidgets.labelTruePositives->setText("Partial mismatch: ");
-    _groundTruthWidgets.labelNumTruePositives->setText(QString::number(partialMismatchNum));
-    _groundTruthWidgets.labelFalseNegatives->setText("Mismatch: ");
-    _groundTruthWidgets.labelNumFalseNegatives->setText(QString::number(mismatchNum));
-    _groundTruthWidgets.labelRecall->setText("Average hamming distance: ");
-    _groundTruthWidgets.labelNumRecall->setText(QString::number(avgHamming));
-    _groundTruthWidgets.labelPrecision->setText("Precision (matched, partial): ");
-    _groundTruthWidgets.labelNumPrecision->setText(QString::number(precMatch, 'f', 2) + "%, " +
-            QString::number(precPartly, 'f', 2) + "%");
+    switch (_selectedStage) {
+    case BeesBookCommon::Stage::Localizer:
+        _groundTruthWidgets.setResults(evaluated ? &counts->localizer : nullptr);
+        break;
+    case BeesBookCommon::Stage::EllipseFitter:
+        _groundTruthWidgets.setResults(evaluated ? &counts->ellipsefitter : nullptr);
+        break;
+    case BeesBookCommon::Stage::GridFitter:
+        _groundTruthWidgets.setResults(evaluated ? &counts->gridfitter : nullptr);
+        break;
+    case BeesBookCommon::Stage::Decoder:
+        _groundTruthWidgets.setDecoderResults(evaluated ? &counts->decoder : nullptr);
+        break;
+    default:
+        _groundTruthWidgets.setResults(nullptr);
+        break;
+    }
 }
 
-void BeesBookImgAnalysisTracker::paint(size_t, BC::ProxyMat &image, View const &view) {
+void BeesBookImgAnalysisTracker::paint(size_t frameNumber, BC::ProxyMat &image, View const &view) {
     cv::ellipse(image.getMat(), cv::RotatedRect(cv::Point2f(100, 100), cv::Size2f(50, 50), 0), cv::Scalar(255, 0, 0));
 
-    if (_tagListLock.try_lock()) {
-        // restore original ground truth labels after they have possibly been
-        // modified by the decoder evaluation
-        if (_selectedStage != BeesBookCommon::Stage::Decoder) {
-            _groundTruthWidgets.labelFalsePositives->setText("False positives: ");
-            _groundTruthWidgets.labelTruePositives->setText("True positives: ");
-            _groundTruthWidgets.labelFalseNegatives->setText("False negatives: ");
-            _groundTruthWidgets.labelRecall->setText("Recall: ");
-            _groundTruthWidgets.labelPrecision->setText("Precision: ");
-        }
+    // the tracking thread never modifies a published snapshot, no locking required
+    const std::shared_ptr<const BBTrackingSnapshot> snapshot = getSnapshot();
+    if (!snapshot) {
+        return;
+    }
+    const BBVisualizationData &visualizationData = snapshot->visualizationData;
 
-        switch (_selectedStage) {
-        case BeesBookCommon::Stage::Preprocessor:
-            if ((view.name == "Preprocessor Output")
-                    && (_visualizationData.preprocessorImage)) {
-                image.setMat(rgbMatFromBwMat(
-                                 _visualizationData.preprocessorImage.get(),
-                                 image.getMat().type()));
-            } else if ((view.name == "Clahe")
-                       && (_visualizationData.preprocessorClahe)) {
-                image.setMat(rgbMatFromBwMat(
-                                 _visualizationData.preprocessorClahe.get(),
-                                 image.getMat().type()));
-            }
-            break;
-        case BeesBookCommon::Stage::Localizer:
-            if ((view.name == "Blobs")
-                    && (_visualizationData.localizerBlobImage)) {
-                image.setMat(rgbMatFromBwMat(
-                                 _visualizationData.localizerBlobImage.get(),
-                                 image.getMat().type()));
-            } else if ((view.name == "Input")
-                       && (_visualizationData.localizerInputImage)) {
-                image.setMat(rgbMatFromBwMat(
-                                 _visualizationData.localizerInputImage.get(),
-                                 image.getMat().type()));
-
-            } else if ((view.name == "Threshold")
-                       && (_visualizationData.localizerThresholdImage)) {
-                image.setMat(rgbMatFromBwMat(
-                                 _visualizationData.localizerThresholdImage.get(),
-                                 image.getMat().type()));
-            }
-            break;
-        case BeesBookCommon::Stage::EllipseFitter:
-            if ((view.name == "Canny Edge")
-                    && (_visualizationData.ellipsefitterCannyEdge)) {
-                image.setMat(rgbMatFromBwMat(
-                                 _visualizationData.ellipsefitterCannyEdge.get(),
-                                 image.getMat().type()));
-            }
-            visualizeEllipseFitterOutput(image.getMat());
-            break;
-        case BeesBookCommon::Stage::GridFitter:
-            visualizeGridFitterOutput(image.getMat());
-            break;
-        case BeesBookCommon::Stage::Decoder:
-            visualizeDecoderOutput(image.getMat());
-            break;
-        default:
-            break;
+    // converted views are cached until tracking publishes a new snapshot
+    const auto getDisplayImage = [&](LazyView const & lazyView) -> cv::Mat const & {
+        return snapshot->displayCache.get(frameNumber, view.name, image.getMat().type(), [&]() {
+            return lazyView.get();
+        });
+    };
+
+    switch (_selectedStage) {
+    case BeesBookCommon::Stage::Preprocessor:
+        if ((view.name == "Preprocessor Output")
+                && (visualizationData.preprocessorImage)) {
+            image.setMat(getDisplayImage(visualizationData.preprocessorImage));
+        } else if ((view.name == "Clahe")
+                   && (visualizationData.preprocessorClahe)) {
+            image.setMat(getDisplayImage(visualizationData.preprocessorClahe));
         }
-        _tagListLock.unlock();
-    } else {
-        return;
+        break;
+    case BeesBookCommon::Stage::Localizer:
+        if ((view.name == "Blobs")
+                && (visualizationData.localizerBlobImage)) {
+            image.setMat(getDisplayImage(visualizationData.localizerBlobImage));
+        } else if ((view.name == "Input")
+                   && (visualizationData.localizerInputImage)) {
+            image.setMat(getDisplayImage(visualizationData.localizerInputImage));
+        } else if ((view.name == "Threshold")
+                   && (visualizationData.localizerThresholdImage)) {
+            image.setMat(getDisplayImage(visualizationData.localizerThresholdImage));
+        }
+        break;
+    case BeesBookCommon::Stage::EllipseFitter:
+        if ((view.name == "Canny Edge")
+                && (visualizationData.ellipsefitterCannyEdge)) {
+            // the ellipses are drawn into the image, keep the cached conversion clean
+            image.setMat(getDisplayImage(visualizationData.ellipsefitterCannyEdge).clone());
+        }
+        visualizeEllipseFitterOutput(*snapshot->results, image.getMat());
+        break;
+    case BeesBookCommon::Stage::GridFitter:
+        visualizeGridFitterOutput(*snapshot->results, image.getMat());
+        break;
+    case BeesBookCommon::Stage::Decoder:
+        visualizeDecoderOutput(*snapshot->results, image.getMat());
+        break;
+    default:
+        break;
     }
 }
 
 void BeesBookImgAnalysisTracker::paintOverlay(size_t, QPainter *painter, View const &) {
     painter->setPen(QColor(255, 0, 0));
     painter->drawEllipse(QRectF(QPointF(100.f, 100.f), QSize(100, 100)));
-    if (_tagListLock.try_lock()) {
+
+    const std::shared_ptr<const BBTrackingSnapshot> snapshot = getSnapshot();
+    if (!snapshot) {
+        return;
+    }
+
+    const QPen pen = getDefaultPen(painter);
+
+    // the labels are filled from the counts of every painted snapshot, independent of
+    // whether its overlay is cached
+    const BBStageResults &results = *snapshot->results;
+    showGroundTruthCounts(results);
+
+    // the overlay of the stage results is only rebuilt if another stage has been selected
+    if (!results.overlayStage || results.overlayStage.get() != _selectedStage) {
+        OverlayBatch &overlay = results.overlay;
+        overlay.clear();
 
         switch (_selectedStage) {
         case BeesBookCommon::Stage::Preprocessor:
             break;
         case BeesBookCommon::Stage::Localizer:
-            visualizeLocalizerOutputOverlay(painter);
+            visualizeLocalizerOutputOverlay(results, overlay);
             break;
         case BeesBookCommon::Stage::EllipseFitter:
-            visualizeEllipseFitterOutputOverlay(painter);
+            visualizeEllipseFitterOutputOverlay(results, overlay);
             break;
         case BeesBookCommon::Stage::GridFitter:
-            visualizeGridFitterOutputOverlay(painter);
+            visualizeGridFitterOutputOverlay(results, overlay);
             break;
         case BeesBookCommon::Stage::Decoder:
-            visualizeDecoderOutputOverlay(painter);
+            visualizeDecoderOutputOverlay(results, overlay);
             break;
         default:
             break;
         }
-        _tagListLock.unlock();
-    } else {
-        return;
+
+        results.overlayStage = _selectedStage;
     }
+
+    results.overlay.draw(painter, pen);
 }
 
 void BeesBookImgAnalysisTracker::settingsChanged(
     const BeesBookCommon::Stage stage) {
-    switch (stage) {
-    case BeesBookCommon::Stage::Preprocessor:
-        _preprocessor.loadSettings(
-            BeesBookCommon::getPreprocessorSettings(m_settings));
-        break;
-    case BeesBookCommon::Stage::Localizer:
-        _localizer.loadSettings(
-            BeesBookCommon::getLocalizerSettings(m_settings));
-        break;
-    case BeesBookCommon::Stage::EllipseFitter:
-        _ellipsefitter.loadSettings(
-            BeesBookCommon::getEllipseFitterSettings(m_settings));
-        break;
-    case BeesBookCommon::Stage::GridFitter:
-        _gridFitter.loadSettings(
-            BeesBookCommon::getGridfitterSettings(m_settings));
-        break;
-    case BeesBookCommon::Stage::Decoder:
-        // TODO
-        break;
-    default:
-        break;
+    {
+        // the stage objects are only touched by the tracking thread
+        const std::lock_guard<std::mutex> lock(_pendingSettingsLock);
+        _pendingSettings = BeesBookCommon::getPipelineSettings(m_settings);
+        _pendingSettingsStages.insert(stage);
+    }
+
+    // the loaded results do not match the new settings, track the frame instead
+    if (_loadedResults) {
+        _loadedResults.reset();
+        if (_lastFrame) {
+            submitTracking(_lastFrame.get());
+        }
+        return;
+    }
+
+    // restart a run that would otherwise finish with outdated settings
+    if (_trackingWorker.isBusy() && _lastFrame) {
+        submitTracking(_lastFrame.get());
     }
 }
 
+void BeesBookImgAnalysisTracker::numThreadsChanged(int numThreads) {
+    m_settings.setParam(BeesBookCommon::Params::BASE + BeesBookCommon::Params::NUM_THREADS, numThreads);
+
+    // the thread pool is replaced by the tracking thread before the next run
+    // the views are computed by the GUI thread
+    _viewStages.setNumThreads(static_cast<size_t>(numThreads));
+
+    const std::lock_guard<std::mutex> lock(_pendingSettingsLock);
+    _pendingNumThreads = static_cast<size_t>(numThreads);
+}
+
 void BeesBookImgAnalysisTracker::loadGroundTruthData() {
     QString filename = QFileDialog::getOpenFileName(QApplication::activeWindow(),
                        tr("Load tracking data"), "", tr("Data Files (*.tdat)"));
@@ -738,15 +1044,29 @@ void BeesBookImgAnalysisTracker::loadGroundTruthData() {
         return;
     }
 
-    std::ifstream is(filename.toStdString());
-
-    cereal::JSONInputArchive ar(is);
-
-    // load serialized data into member .data
-    BC::Serialization::Data data;
-    ar(data);
+    // the annotations are read from a binary cache next to the .tdat file, which is
+    // only (re)built when the file has changed
+    std::shared_ptr<const GroundTruthCache> groundTruthCache;
+    try {
+        const CursorOverrideRAII cursor(Qt::WaitCursor);
+        const std::shared_ptr<GroundTruthCache> cache = std::make_shared<GroundTruthCache>(filename.toStdString());
+        if (cache->wasRebuilt()) {
+            Q_EMIT notifyGUI("ground truth cache written to " + cache->getCachePath(),
+                             BC::Messages::MessageType::NOTIFICATION);
+        }
+        groundTruthCache = cache;
+    } catch (std::exception const &e) {
+        Q_EMIT notifyGUI(std::string("Unable to load ground truth: ") + e.what(), BC::Messages::MessageType::FAIL);
+        return;
+    }
 
-    _groundTruthEvaluation.emplace(gtConverter::ResultsFromSerializationData(data));
+    {
+        // the annotations are replaced by the tracking thread before its next job, a job
+        // submitted later does not drop them
+        const std::lock_guard<std::mutex> lock(_pendingSettingsLock);
+        _pendingGroundTruth = groundTruthCache;
+    }
+    _groundTruthLoaded = true;
 
     const std::array<QLabel *, 10> labels { _groundTruthWidgets.labelFalsePositives,
               _groundTruthWidgets.labelFalseNegatives, _groundTruthWidgets.labelTruePositives,
@@ -760,13 +1080,26 @@ void BeesBookImgAnalysisTracker::loadGroundTruthData() {
         label->setEnabled(true);
     }
 
-    if (!_taglist.empty()) {
-        _groundTruthEvaluation->evaluateLocalizer(getCurrentFrameNumber(), _taglist);
-        _groundTruthEvaluation->evaluateEllipseFitter(_taglist);
-        _groundTruthEvaluation->evaluateGridFitter();
-        _groundTruthEvaluation->evaluateDecoder();
+    // evaluate the current results against the new ground truth. Tracked results are
+    // evaluated by a new run, which reuses the cached stage outputs
+    const std::shared_ptr<const BBTrackingSnapshot> snapshot = getSnapshot();
+    if (snapshot && snapshot->results && snapshot->results->loaded) {
+        const size_t frameNumber = snapshot->results->frameNumber;
+        const taglist_t taglist  = snapshot->results->taglist;
+
+        _trackingWorker.submit([ = ](CancellationToken const &) {
+            const std::lock_guard<std::mutex> lock(_tagListLock);
+            applyPendingGroundTruth();
+            try {
+                publishTaglist(frameNumber, taglist);
+            } catch (std::exception const &e) {
+                Q_EMIT notifyGUI(std::string("Unable to evaluate ground truth: ") + e.what(),
+                                 BC::Messages::MessageType::FAIL);
+            }
+        });
+    } else if (_lastFrame) {
+        submitTracking(_lastFrame.get());
     }
-    //TODO: maybe check filehash here
 }
 
 void BeesBookImgAnalysisTracker::loadConfig() {
@@ -782,48 +1115,27 @@ void BeesBookImgAnalysisTracker::loadConfig() {
 void BeesBookImgAnalysisTracker::setPipelineConfig(const std::string &filename) {
     // TODO! Add GUI widgets
 
-    pipeline::settings::preprocessor_settings_t preprocessor_settings;
-    pipeline::settings::localizer_settings_t localizer_settings;
-    pipeline::settings::ellipsefitter_settings_t ellipsefitter_settings;
-    pipeline::settings::gridfitter_settings_t gridfitter_settings;
-
-    for (pipeline::settings::settings_abs *settings :
-        std::array<pipeline::settings::settings_abs *, 4>( {
-        &preprocessor_settings,
-        &localizer_settings,
-        &ellipsefitter_settings,
-        &gridfitter_settings
-    })) {
-        settings->loadFromJson(filename);
-    }
-
-    static const boost::filesystem::path deeplocalizer_model_path(BOOST_PP_STRINGIZE(MODEL_BASE_PATH));
-
-    boost::filesystem::path model_path(localizer_settings.get_deeplocalizer_model_file());
-    model_path = deeplocalizer_model_path / model_path.parent_path().leaf() / model_path.filename();
-
-    boost::filesystem::path param_path(localizer_settings.get_deeplocalizer_param_file());
-    param_path = deeplocalizer_model_path / model_path.parent_path().leaf() / param_path.filename();
-
-    localizer_settings.setValue(pipeline::settings::Localizer::Params::DEEPLOCALIZER_MODEL_FILE,
-                                model_path.string());
-    localizer_settings.setValue(pipeline::settings::Localizer::Params::DEEPLOCALIZER_PARAM_FILE,
-                                param_path.string());
+    BeesBookCommon::pipeline_settings_t settings;
 
     try {
-        _preprocessor.loadSettings(preprocessor_settings);
-        _localizer.loadSettings(localizer_settings);
-        _ellipsefitter.loadSettings(ellipsefitter_settings);
-        _gridFitter.loadSettings(gridfitter_settings);
+        settings = BeesBookCommon::loadPipelineSettings(filename);
     } catch (std::runtime_error err) {
         Q_EMIT notifyGUI(std::string("Unable to load settings: ") + err.what(), BC::Messages::MessageType::FAIL);
         return;
     }
 
-    BeesBookCommon::setPreprocessorSettings(m_settings, preprocessor_settings);
-    BeesBookCommon::setLocalizerSettings(m_settings, localizer_settings);
-    BeesBookCommon::setEllipseFitterSettings(m_settings, ellipsefitter_settings);
-    BeesBookCommon::setGridFitterSettings(m_settings, gridfitter_settings);
+    BeesBookCommon::setPipelineSettings(m_settings, settings);
+
+    {
+        const std::lock_guard<std::mutex> lock(_pendingSettingsLock);
+        _pendingSettings = settings;
+        _pendingSettingsStages.insert({
+            BeesBookCommon::Stage::Preprocessor,
+            BeesBookCommon::Stage::Localizer,
+            BeesBookCommon::Stage::EllipseFitter,
+            BeesBookCommon::Stage::GridFitter
+        });
+    }
 
     stageSelectionToogled(_selectedStage, true);
 }
@@ -866,32 +1178,28 @@ void BeesBookImgAnalysisTracker::exportConfiguration() {
 void BeesBookImgAnalysisTracker::loadTaglist() {
     QString path = QFileDialog::getOpenFileName(QApplication::activeWindow(),
                    tr("Load taglist data"), "",
-                   tr("Data Files (*.dat)"));
+                   tr("Binary taglist files (*.bbtags)"));
 
     if (path.isEmpty()) {
         return;
     }
 
+    // only the record headers are read, the frames are read when they are shown
     try {
-        _taglist = loadSerializedTaglist(path.toStdString());
-
-        if (_groundTruthEvaluation) {
-            _groundTruthEvaluation->evaluateLocalizer(getCurrentFrameNumber(), _taglist);
-            _groundTruthEvaluation->evaluateEllipseFitter(_taglist);
-            _groundTruthEvaluation->evaluateGridFitter();
-            _groundTruthEvaluation->evaluateDecoder();
-        }
-
-        Q_EMIT update();
+        _loadedResults = std::make_shared<Batch::BinaryTaglistReader>(path.toStdString());
     } catch (std::exception const &e) {
-        std::stringstream msg;
-        msg << "Unable to load tracking data." << std::endl << std::endl;
-        msg << "Error: " << e.what() << std::endl;
         QMessageBox::warning(QApplication::activeWindow(), "Unable to load tracking data",
                              QString::fromStdString(e.what()));
+        return;
     }
 
-    notifyGUI("import of serialized taglist data finished");
+    const size_t frameNumber = getCurrentFrameNumber();
+    if (_loadedResults->hasFrame(frameNumber)) {
+        showLoadedResults(frameNumber);
+    }
+
+    Q_EMIT notifyGUI("loaded results of " + std::to_string(_loadedResults->getNumFrames()) +
+                     " frames from " + path.toStdString(), BC::Messages::MessageType::NOTIFICATION);
 }
 
 void BeesBookImgAnalysisTracker::stageSelectionToogled(BeesBookCommon::Stage stage, bool checked) {
@@ -931,16 +1239,84 @@ void BeesBookImgAnalysisTracker::resetViews() {
     Q_EMIT registerViews({});
 }
 
-void GroundTruthWidgets::setResults(const size_t numGroundTruth, const size_t numTruePositives,
-                                    const size_t numFalsePositives, const size_t numFalseNegatives) const {
-    const double recall    = numGroundTruth ?
-                             (static_cast<double>(numTruePositives) / static_cast<double>(numGroundTruth)) * 100. : 0.;
-    const double precision = (numTruePositives + numFalsePositives) ?
-                             (static_cast<double>(numTruePositives) / static_cast<double>(numTruePositives + numFalsePositives)) * 100. : 0.;
+void BBVisualizationData::reset(const BeesBookCommon::Stage firstStage) {
+    if (firstStage <= BeesBookCommon::Stage::Preprocessor) {
+        preprocessorImage.reset();
+        preprocessorClahe.reset();
+    }
+    if (firstStage <= BeesBookCommon::Stage::Localizer) {
+        localizerInputImage.reset();
+        localizerThresholdImage.reset();
+        localizerSobelImage.reset();
+        localizerBlobImage.reset();
+    }
+    if (firstStage <= BeesBookCommon::Stage::EllipseFitter) {
+        ellipsefitterCannyEdge.reset();
+    }
+}
+
+void BBStageCache::setValid(const BeesBookCommon::Stage stage) {
+    validStage = stage;
+    outputIds[static_cast<size_t>(stage)] = ++lastOutputId;
+}
+
+void BBStageCache::invalidate(const BeesBookCommon::Stage stage) {
+    if (stage == BeesBookCommon::Stage::NoProcessing) {
+        validStage = BeesBookCommon::Stage::NoProcessing;
+    } else if (validStage >= stage) {
+        validStage = static_cast<BeesBookCommon::Stage>(static_cast<uint8_t>(stage) - 1);
+    }
+}
+
+void GroundTruthWidgets::setResults(Batch::StageCounts const *counts) const {
+    labelFalsePositives->setText("False positives: ");
+    labelTruePositives->setText("True positives: ");
+    labelFalseNegatives->setText("False negatives: ");
+    labelRecall->setText("Recall: ");
+    labelPrecision->setText("Precision: ");
+
+    if (!counts) {
+        clearValues();
+        return;
+    }
 
-    labelNumFalseNegatives->setText(QString::number(numFalseNegatives));
-    labelNumFalsePositives->setText(QString::number(numFalsePositives));
-    labelNumTruePositives->setText(QString::number(numTruePositives));
-    labelNumRecall->setText(QString::number(recall, 'f', 2) + "%");
-    labelNumPrecision->setText(QString::number(precision, 'f', 2) + "%");
+    labelNumFalseNegatives->setText(QString::number(counts->numFalseNegatives));
+    labelNumFalsePositives->setText(QString::number(counts->numFalsePositives));
+    labelNumTruePositives->setText(QString::number(counts->numTruePositives));
+    labelNumRecall->setText(QString::number(counts->recall() * 100., 'f', 2) + "%");
+    labelNumPrecision->setText(QString::number(counts->precision() * 100., 'f', 2) + "%");
+}
+
+void GroundTruthWidgets::setDecoderResults(Batch::DecoderCounts const *counts) const {
+    labelFalsePositives->setText("Match: ");
+    labelTruePositives->setText("Partial mismatch: ");
+    labelFalseNegatives->setText("Mismatch: ");
+    labelRecall->setText("Average hamming distance: ");
+    labelPrecision->setText("Precision (matched, partial): ");
+
+    if (!counts) {
+        clearValues();
+        return;
+    }
+
+    const size_t numResults = counts->numResults;
+    const double precMatch  = numResults ? (static_cast<double>(counts->numMatches) / static_cast<double>(numResults)) * 100. : 0.;
+    const double precPartly = numResults ? (static_cast<double>(counts->numMatches + counts->numPartialMatches) /
+                                            static_cast<double>(numResults)) * 100. : 0.;
+
+    labelNumFalsePositives->setText(QString::number(counts->numMatches));
+    labelNumTruePositives->setText(QString::number(counts->numPartialMatches));
+    labelNumFalseNegatives->setText(QString::number(counts->numMismatches));
+    labelNumRecall->setText(QString::number(counts->averageHamming()));
+    labelNumPrecision->setText(QString::number(precMatch, 'f', 2) + "%, " +
+                               QString::number(precPartly, 'f', 2) + "%");
+}
+
+void GroundTruthWidgets::clearValues() const {
+    for (QLabel *label : {
+                labelNumFalsePositives, labelNumTruePositives, labelNumFalseNegatives,
+                labelNumPrecision, labelNumRecall
+            }) {
+        label->setText("");
+    }
 }
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <array>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <QPainter>
 
 #include <opencv2/opencv.hpp>
@@ -23,34 +27,166 @@
 #include <biotracker/util/CvHelper.h>
 #include <biotracker/serialization/SerializationData.h>
 
+#include "BinaryTaglist.h"
+#include "BioTrackerSettings.h"
 #include "Common.h"
+#include "FrameBufferPool.h"
+#include "FrameIngestion.h"
+#include "GroundTruthCache.h"
+#include "LatestJobWorker.h"
 #include "ParamsWidget.h"
+#include "RleImage.h"
+#include "RunStatistics.h"
+#include "StageCheckpoint.h"
+#include "TagStageExecutor.h"
+#include "Utils.h"
+#include "Visualization.h"
 
 namespace BC = BioTracker::Core;
 
 class PipelineGrid;
 
+/**
+ * view of a pipeline stage that is only computed when it is painted for the first time.
+ * Copies share the produced image, so a view that is carried over to the next snapshot
+ * is not computed again. Only the GUI thread may call get().
+ */
+class LazyView {
+  public:
+    typedef std::function<cv::Mat()> producer_t;
+
+    /**
+     * the stage has been run, the view can be produced on demand
+     *
+     * @param retain keep the produced image. Views that are stored compactly and are
+     *        cheap to produce again (e.g. run-length encoded masks) are not retained,
+     *        their full size image only lives until it has been converted for display
+     */
+    void setProducer(producer_t producer, bool retain = true) {
+        _state = std::make_shared<State>();
+        _state->producer = std::move(producer);
+        _state->retain   = retain;
+    }
+
+    void reset() {
+        _state.reset();
+    }
+
+    explicit operator bool() const { return static_cast<bool>(_state); }
+
+    // compute the view if it has not been retained since the stage has been run
+    cv::Mat get() const {
+        if (!_state->retain) {
+            return _state->producer();
+        }
+        if (!_state->image) {
+            _state->image = _state->producer();
+        }
+        return _state->image.get();
+    }
+
+  private:
+    struct State {
+        producer_t producer;
+        bool retain = true;
+        boost::optional<cv::Mat> image;
+    };
+
+    std::shared_ptr<State> _state;
+};
+
 struct BBVisualizationData {
-    boost::optional<cv::Mat> preprocessorImage;
-    boost::optional<cv::Mat> preprocessorClahe;
-    boost::optional<cv::Mat> localizerInputImage;
-    boost::optional<cv::Mat> localizerThresholdImage;
-    boost::optional<cv::Mat> localizerSobelImage;
-    boost::optional<cv::Mat> localizerBlobImage;
-    boost::optional<cv::Mat> ellipsefitterCannyEdge;
-
-    // these references are just stored for convenience in order to invalidate all
-    // visualizations in a loop
-    typedef std::array<std::reference_wrapper<boost::optional<cv::Mat>>, 7> reference_array_t;
-
-    reference_array_t visualizations = reference_array_t {
-        preprocessorImage,
-        preprocessorClahe,
-        localizerInputImage,
-        localizerThresholdImage,
-        localizerSobelImage,
-        localizerBlobImage,
-        ellipsefitterCannyEdge };
+    LazyView preprocessorImage;
+    LazyView preprocessorClahe;
+    LazyView localizerInputImage;
+    LazyView localizerThresholdImage;
+    LazyView localizerSobelImage;
+    LazyView localizerBlobImage;
+    LazyView ellipsefitterCannyEdge;
+
+    // invalidate the views of the given stage and all following stages
+    void reset(BeesBookCommon::Stage firstStage);
+};
+
+/**
+ * grayscale version of a frame passed to track(). Every call gets a new generation, even
+ * if the frame number repeats (e.g. after opening another video), so the cached stage
+ * outputs are only reused when the same frame is tracked again.
+ */
+struct BBTrackedFrame {
+    ulong frameNumber;
+    cv::Mat frameGray;
+    size_t generation;
+};
+
+/**
+ * outputs of the pipeline stages for the current frame. When only the settings of a
+ * later stage change, tracking resumes from that stage instead of rerunning the whole
+ * pipeline.
+ */
+struct BBStageCache {
+    // BBTrackedFrame::generation of the frame the outputs belong to
+    boost::optional<size_t> frameGeneration;
+    cv::Mat frameGray;
+
+    pipeline::PreprocessorResult preprocessorResult;
+    BeesBookCommon::taglist_t localizerTaglist;
+    BeesBookCommon::taglist_t ellipsefitterTaglist;
+    BeesBookCommon::taglist_t gridfitterTaglist;
+    BeesBookCommon::taglist_t decoderTaglist;
+
+    // last stage whose output is cached
+    BeesBookCommon::Stage validStage = BeesBookCommon::Stage::NoProcessing;
+
+    bool isValid(BeesBookCommon::Stage stage) const { return validStage >= stage; }
+
+    // the output of the given stage has been recomputed
+    void setValid(BeesBookCommon::Stage stage);
+    // invalidate the output of the given stage and all following stages
+    void invalidate(BeesBookCommon::Stage stage);
+
+    // changes whenever the output of the stage is recomputed
+    size_t getOutputId(BeesBookCommon::Stage stage) const { return outputIds[static_cast<size_t>(stage)]; }
+
+    std::array<size_t, static_cast<size_t>(BeesBookCommon::Stage::Decoder) + 1> outputIds {};
+    size_t lastOutputId = 0;
+};
+
+/**
+ * output of one stage together with its ground truth evaluation. Immutable once built,
+ * it is shared by all snapshots until the output of the stage or the ground truth changes.
+ */
+struct BBStageResults {
+    BeesBookCommon::Stage stage = BeesBookCommon::Stage::NoProcessing;
+    size_t frameNumber = 0;
+    // BBStageCache::getOutputId and ground truth generation the results were built from
+    size_t outputId = 0;
+    size_t groundTruthGeneration = 0;
+    // taglist loaded from a file instead of being tracked
+    bool loaded = false;
+
+    BeesBookCommon::taglist_t taglist;
+    // input of the localizer evaluation, which keeps references to these tags
+    BeesBookCommon::taglist_t localizerTaglist;
+    boost::optional<GroundTruthEvaluation> groundTruthEvaluation;
+    // counts of the evaluation, stages after the evaluated ones are empty
+    boost::optional<Batch::FrameEvaluation> groundTruthCounts;
+
+    // derived from the results above by the GUI thread when they are painted
+    mutable Visualization::OverlayBatch overlay;
+    mutable boost::optional<BeesBookCommon::Stage> overlayStage;
+};
+
+/**
+ * results of one tracking run. A snapshot is immutable once it has been published,
+ * painting only reads the latest one and never waits for the tracking thread.
+ */
+struct BBTrackingSnapshot {
+    std::shared_ptr<const BBStageResults> results;
+    BBVisualizationData visualizationData;
+
+    // derived from the views above by the GUI thread when the snapshot is painted
+    mutable Visualization::DisplayCache displayCache;
 };
 
 struct GroundTruthWidgets {
@@ -66,8 +202,10 @@ struct GroundTruthWidgets {
     QLabel *labelRecall;
     QLabel *labelPrecision;
 
-    void setResults(const size_t numGroundTruth, const size_t numTruePositives,
-                    const size_t numFalsePositives, const size_t numFalseNegatives) const;
+    // counts of the localizer, ellipsefitter or gridfitter, the values are cleared if null
+    void setResults(Batch::StageCounts const *counts) const;
+    void setDecoderResults(Batch::DecoderCounts const *counts) const;
+    void clearValues() const;
 };
 
 class BeesBookImgAnalysisTracker : public BC::TrackingAlgorithm {
@@ -75,38 +213,100 @@ class BeesBookImgAnalysisTracker : public BC::TrackingAlgorithm {
   public:
     BeesBookImgAnalysisTracker(BC::Settings &settings);
 
+    /**
+     * starts tracking of the frame on the tracking thread and returns immediately.
+     * A run that is still in progress is cancelled at the next stage boundary.
+     */
     void track(ulong frameNumber, const cv::Mat &frame) override;
     virtual void paint(size_t frameNumber, BC::ProxyMat &image, View const &view = OriginalView) override;
     virtual void paintOverlay(size_t frameNumber, QPainter *painter, View const &view = OriginalView) override;
 
   private:
+    // the statistics of the run are reported whenever this number of frames has been added
+    static const size_t RUN_STATISTICS_INTERVAL = 100;
+
     QVBoxLayout _biotrackerWidgetLayout;
     ParamsWidget _paramsWidget;
     QWidget      _toolsWidget;
     GroundTruthWidgets _groundTruthWidgets;
 
     BeesBookCommon::Stage _selectedStage;
+    FrameIngestion          _frameIngestion;
     pipeline::Preprocessor  _preprocessor;
     pipeline::Localizer     _localizer;
-    pipeline::EllipseFitter _ellipsefitter;
-    pipeline::GridFitter    _gridFitter;
-    pipeline::Decoder       _decoder;
+    // ellipsefitter, gridfitter and decoder
+    TagStageExecutor        _tagStages;
+    // used by the GUI thread to compute views on demand
+    TagStageExecutor        _viewStages;
 
     cv::Mat _image;
+    // held by the tracking thread while it runs a job
     std::mutex _tagListLock;
-    taglist_t _taglist;
 
-    boost::optional<GroundTruthEvaluation> _groundTruthEvaluation;
+    // annotations of the video, each snapshot evaluates against the annotations of its frame.
+    // Only used by the tracking thread
+    std::shared_ptr<const GroundTruthCache> _groundTruthCache;
+    // incremented whenever ground truth is loaded, outdates all evaluations
+    size_t _groundTruthGeneration;
+    // set by the GUI thread as soon as ground truth has been loaded
+    bool _groundTruthLoaded;
+    // views of the cached stages, copied into every snapshot
     BBVisualizationData _visualizationData;
+    BBStageCache _stageCache;
+    // evaluated results of the last run of each stage, only used by the tracking thread
+    std::map<BeesBookCommon::Stage, std::shared_ptr<const BBStageResults>> _resultsCache;
+    // ground truth statistics of all frames tracked up to the decoder, only used by the tracking
+    // thread. Reset whenever the settings or the ground truth change
+    RunStatistics _runStatistics;
+    // results of every frame tracked up to the decoder are appended to this file, if configured
+    std::string _resultFile;
+    std::unique_ptr<Batch::BinaryTaglistWriter> _resultWriter;
+    // last results written, a frame is only written again if its results have changed
+    std::shared_ptr<const BBStageResults> _writtenResults;
+    // the output of every tracked stage is written to this checkpoint directory, if configured
+    std::string _checkpointDirectory;
+    std::unique_ptr<Batch::CheckpointWriter> _checkpointWriter;
+    // BBStageCache::getOutputId of the last output written of each stage
+    std::array<size_t, static_cast<size_t>(BeesBookCommon::Stage::Decoder) + 1> _checkpointOutputIds {};
+    // loaded result file, its frames are shown instead of being tracked. Only used by the GUI
+    // thread and the jobs showing its frames, unloaded when the settings change
+    std::shared_ptr<const Batch::BinaryTaglistReader> _loadedResults;
+    // latest complete tracking results, only accessed with std::atomic_load/atomic_store
+    std::shared_ptr<const BBTrackingSnapshot> _snapshot;
+    // per-frame images (gray frame, localizer input copies and views)
+    FrameBufferPool _bufferPool;
+
+    // settings changes are applied by the tracking thread before the next run
+    std::mutex _pendingSettingsLock;
+    boost::optional<BeesBookCommon::pipeline_settings_t> _pendingSettings;
+    std::set<BeesBookCommon::Stage> _pendingSettingsStages;
+    boost::optional<size_t> _pendingNumThreads;
+    // loaded ground truth, replaces _groundTruthCache before the next job
+    std::shared_ptr<const GroundTruthCache> _pendingGroundTruth;
+
+    // last frame passed to track(), used to track it again with changed settings or ground truth
+    boost::optional<BBTrackedFrame> _lastFrame;
+    size_t _lastFrameGeneration;
+    boost::optional<CursorOverrideRAII> _busyCursor;
+
+    // has to be the last member, the tracking thread has to be stopped
+    // before any of the members it uses are destroyed
+    LatestJobWorker _trackingWorker;
 
     static QPen getDefaultPen(QPainter *painter);
-    void visualizeLocalizerOutputOverlay(QPainter *painter) const;
-    void visualizeEllipseFitterOutput(cv::Mat &image) const;
-    void visualizeEllipseFitterOutputOverlay(QPainter *painter) const;
-    void visualizeGridFitterOutput(cv::Mat &image) const;
-    void visualizeGridFitterOutputOverlay(QPainter *painter) const;
-    void visualizeDecoderOutput(cv::Mat &image) const;
-    void visualizeDecoderOutputOverlay(QPainter *painter) const;
+    void visualizeLocalizerOutputOverlay(BBStageResults const &stageResults,
+                                         Visualization::OverlayBatch &overlay) const;
+    void visualizeEllipseFitterOutput(BBStageResults const &stageResults, cv::Mat &image) const;
+    void visualizeEllipseFitterOutputOverlay(BBStageResults const &stageResults,
+                                             Visualization::OverlayBatch &overlay) const;
+    void visualizeGridFitterOutput(BBStageResults const &stageResults, cv::Mat &image) const;
+    void visualizeGridFitterOutputOverlay(BBStageResults const &stageResults,
+                                          Visualization::OverlayBatch &overlay) const;
+    void visualizeDecoderOutput(BBStageResults const &stageResults, cv::Mat &image) const;
+    void visualizeDecoderOutputOverlay(BBStageResults const &stageResults,
+                                       Visualization::OverlayBatch &overlay) const;
+    // fill the ground truth labels with the counts of the selected stage
+    void showGroundTruthCounts(BBStageResults const &stageResults) const;
 
     template<typename Widget>
     void setParamsWidget() {
@@ -118,9 +318,37 @@ class BeesBookImgAnalysisTracker : public BC::TrackingAlgorithm {
 
     void resetViews();
 
+    void submitTracking(BBTrackedFrame const &frame);
+    void runTracking(BBTrackedFrame const &frame, BeesBookCommon::Stage selectedStage,
+                     CancellationToken const &cancellation);
+    void runStages(cv::Mat const &frameGray, BeesBookCommon::Stage selectedStage,
+                   CancellationToken const &cancellation);
+    void addRunStatistics(Batch::FrameEvaluation const &frame);
+    void writeResults(std::shared_ptr<const BBStageResults> const &results);
+    void writeCheckpoint(size_t frameNumber, BeesBookCommon::Stage selectedStage);
+    // cached results of the stage if neither its output nor the ground truth have changed
+    std::shared_ptr<const BBStageResults> getStageResults(size_t frameNumber, BeesBookCommon::Stage stage);
+    void applyPendingSettings();
+    void applyPendingGroundTruth();
+
+    std::shared_ptr<const BBTrackingSnapshot> getSnapshot() const;
+    void publishSnapshot(std::shared_ptr<const BBTrackingSnapshot> snapshot);
+    void evaluateGroundTruth(BBStageResults &results) const;
+    // replace the results of the current snapshot, e.g. by a loaded taglist, and evaluate them.
+    // Only called by jobs of the tracking thread while they hold _tagListLock
+    void publishTaglist(size_t frameNumber, BeesBookCommon::taglist_t taglist);
+    // submit a job that publishes the taglist of the frame from the loaded result file
+    void showLoadedResults(size_t frameNumber);
+
+  Q_SIGNALS:
+    // emitted from the tracking thread
+    void trackingBusyChanged(bool busy);
+
   private Q_SLOTS:
+    void onTrackingBusyChanged(bool busy);
     void stageSelectionToogled(BeesBookCommon::Stage stage, bool checked);
     void settingsChanged(const BeesBookCommon::Stage stage);
+    void numThreadsChanged(int numThreads);
     void loadGroundTruthData();
     void loadConfig();
     void setPipelineConfig(std::string const &filename);
@@ -0,0 +1,515 @@
+#include "BinaryTaglist.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+using namespace BeesBookCommon;
+
+namespace {
+/**
+ * appends little-endian values to a buffer
+ */
+class ByteWriter {
+  public:
+    explicit ByteWriter(std::string &buffer)
+        : _buffer(buffer) {
+    }
+
+    void u8(const uint8_t value) {
+        _buffer.push_back(static_cast<char>(value));
+    }
+
+    void u16(const uint16_t value) {
+        u8(static_cast<uint8_t>(value));
+        u8(static_cast<uint8_t>(value >> 8));
+    }
+
+    void u32(const uint32_t value) {
+        u16(static_cast<uint16_t>(value));
+        u16(static_cast<uint16_t>(value >> 16));
+    }
+
+    void u64(const uint64_t value) {
+        u32(static_cast<uint32_t>(value));
+        u32(static_cast<uint32_t>(value >> 32));
+    }
+
+    void i32(const int value) {
+        u32(static_cast<uint32_t>(static_cast<int32_t>(value)));
+    }
+
+    void f32(const double value) {
+        const float single = static_cast<float>(value);
+        uint32_t bits;
+        std::memcpy(&bits, &single, sizeof(bits));
+        u32(bits);
+    }
+
+    void count(const size_t value) {
+        if (value > std::numeric_limits<uint16_t>::max()) {
+            throw std::length_error("too many elements for a binary taglist record");
+        }
+        u16(static_cast<uint16_t>(value));
+    }
+
+  private:
+    std::string &_buffer;
+};
+
+// size of the fixed part of a tag in a record payload
+static const size_t TAG_HEADER_SIZE = 27;
+
+/*
+ * little-endian values at the given position, the caller checks the bounds
+ */
+uint16_t loadU16(const char *data) {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    return static_cast<uint16_t>(bytes[0] | (static_cast<uint16_t>(bytes[1]) << 8));
+}
+
+uint32_t loadU32(const char *data) {
+    return loadU16(data) | (static_cast<uint32_t>(loadU16(data + 2)) << 16);
+}
+
+uint64_t loadU64(const char *data) {
+    return loadU32(data) | (static_cast<uint64_t>(loadU32(data + 4)) << 32);
+}
+
+/**
+ * reads little-endian values from a buffer, counterpart of ByteWriter
+ */
+class ByteReader {
+  public:
+    ByteReader(const char *data, const size_t size)
+        : _data(data),
+          _remaining(size) {
+    }
+
+    uint8_t u8() {
+        return static_cast<uint8_t>(*advance(1));
+    }
+
+    uint16_t u16() {
+        return loadU16(advance(2));
+    }
+
+    uint32_t u32() {
+        return loadU32(advance(4));
+    }
+
+    uint64_t u64() {
+        return loadU64(advance(8));
+    }
+
+    int i32() {
+        return static_cast<int32_t>(u32());
+    }
+
+    double f32() {
+        const uint32_t bits = u32();
+        float single;
+        std::memcpy(&single, &bits, sizeof(single));
+        return single;
+    }
+
+  private:
+    const char *_data;
+    size_t _remaining;
+
+    const char *advance(const size_t size) {
+        if (size > _remaining) {
+            throw std::runtime_error("incomplete binary taglist record");
+        }
+        const char *data = _data;
+        _data      += size;
+        _remaining -= size;
+        return data;
+    }
+};
+
+const char INDEX_MAGIC[8] = { 'B', 'B', 'T', 'A', 'G', 'I', 'D', 'X' };
+
+void writeFileHeader(std::ostream &stream) {
+    std::string header(BinaryTaglist::MAGIC, sizeof(BinaryTaglist::MAGIC));
+    ByteWriter writer(header);
+    writer.u32(BinaryTaglist::VERSION);
+    writer.u32(0);
+    stream.write(header.data(), header.size());
+}
+}
+
+void BinaryTaglist::encode(const taglist_t &taglist, std::string &buffer) {
+    ByteWriter writer(buffer);
+
+    writer.u32(static_cast<uint32_t>(taglist.size()));
+    for (const pipeline::Tag &tag : taglist) {
+        const cv::Rect &roi = tag.getRoi();
+        writer.i32(roi.x);
+        writer.i32(roi.y);
+        writer.i32(roi.width);
+        writer.i32(roi.height);
+        writer.u64(tag.getId());
+        writer.u8(tag.isValid() ? 1 : 0);
+
+        writer.count(tag.getCandidatesConst().size());
+        for (const pipeline::TagCandidate &candidate : tag.getCandidatesConst()) {
+            const pipeline::Ellipse &ellipse = candidate.getEllipse();
+            writer.i32(ellipse.getVote());
+            writer.i32(ellipse.getCen().x);
+            writer.i32(ellipse.getCen().y);
+            writer.i32(ellipse.getAxis().width);
+            writer.i32(ellipse.getAxis().height);
+            writer.f32(ellipse.getAngle());
+            writer.i32(ellipse.getRoiSize().width);
+            writer.i32(ellipse.getRoiSize().height);
+
+            writer.count(candidate.getGridsConst().size());
+            writer.count(candidate.getDecodings().size());
+            for (const PipelineGrid &grid : candidate.getGridsConst()) {
+                writer.i32(grid.getCenter().x);
+                writer.i32(grid.getCenter().y);
+                writer.f32(grid.getRadius());
+                writer.f32(grid.getZRotation());
+                writer.f32(grid.getYRotation());
+                writer.f32(grid.getXRotation());
+            }
+            for (const pipeline::decoding_t &decoding : candidate.getDecodings()) {
+                writer.u16(static_cast<uint16_t>(decoding.to_ulong()));
+            }
+        }
+    }
+}
+
+taglist_t BinaryTaglist::decode(const char *data, const size_t size) {
+    ByteReader reader(data, size);
+
+    const uint32_t numTags = reader.u32();
+    taglist_t taglist;
+    // a corrupt count must not allocate huge amounts of memory
+    taglist.reserve(std::min<size_t>(numTags, size / TAG_HEADER_SIZE));
+
+    for (uint32_t tagIdx = 0; tagIdx < numTags; ++tagIdx) {
+        const int x      = reader.i32();
+        const int y      = reader.i32();
+        const int width  = reader.i32();
+        const int height = reader.i32();
+        pipeline::Tag tag(cv::Rect(x, y, width, height), reader.u64());
+        tag.setValid((reader.u8() & 1) != 0);
+
+        const size_t numCandidates = reader.u16();
+        for (size_t candidateIdx = 0; candidateIdx < numCandidates; ++candidateIdx) {
+            const int vote       = reader.i32();
+            const int centerX    = reader.i32();
+            const int centerY    = reader.i32();
+            const int axisWidth  = reader.i32();
+            const int axisHeight = reader.i32();
+            const double angle   = reader.f32();
+            const int roiWidth   = reader.i32();
+            const int roiHeight  = reader.i32();
+            pipeline::TagCandidate candidate(pipeline::Ellipse(vote, cv::Point2i(centerX, centerY),
+                                             cv::Size(axisWidth, axisHeight), angle,
+                                             cv::Size(roiWidth, roiHeight)));
+
+            const size_t numGrids     = reader.u16();
+            const size_t numDecodings = reader.u16();
+            for (size_t gridIdx = 0; gridIdx < numGrids; ++gridIdx) {
+                const int gridX        = reader.i32();
+                const int gridY        = reader.i32();
+                const double radius    = reader.f32();
+                const double zRotation = reader.f32();
+                const double yRotation = reader.f32();
+                const double xRotation = reader.f32();
+                candidate.getGrids().push_back(PipelineGrid(cv::Point2i(gridX, gridY), radius,
+                                                            zRotation, yRotation, xRotation));
+            }
+
+            std::vector<pipeline::decoding_t> decodings;
+            for (size_t decodingIdx = 0; decodingIdx < numDecodings; ++decodingIdx) {
+                decodings.push_back(pipeline::decoding_t(reader.u16()));
+            }
+            candidate.setDecodings(decodings);
+
+            tag.getCandidates().push_back(std::move(candidate));
+        }
+
+        taglist.push_back(std::move(tag));
+    }
+
+    return taglist;
+}
+
+uint32_t BinaryTaglist::checksum(const char *data, const size_t size) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t idx = 0; idx < size; ++idx) {
+        hash ^= static_cast<unsigned char>(data[idx]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+namespace Batch {
+
+BinaryTaglistWriter::BinaryTaglistWriter(const std::string &path) {
+    boost::system::error_code error;
+    const bool exists = boost::filesystem::exists(path, error) && boost::filesystem::file_size(path, error) > 0;
+
+    if (exists) {
+        uint64_t validSize;
+        {
+            // fails if the file is not a binary taglist file. The mapping has to be
+            // closed before the file can be truncated
+            const BinaryTaglistReader reader(path);
+            validSize = reader.getValidSize();
+        }
+        if (validSize < boost::filesystem::file_size(path)) {
+            boost::filesystem::resize_file(path, validSize);
+        }
+    }
+
+    _stream.open(path, std::ios::binary | std::ios::app);
+    if (!_stream) {
+        throw std::runtime_error("unable to open output file " + path);
+    }
+
+    if (!exists) {
+        writeFileHeader(_stream);
+        _stream.flush();
+    }
+}
+
+void BinaryTaglistWriter::write(const size_t frameNumber, const taglist_t &taglist) {
+    // the payload is encoded after the record header, whose size and checksum are filled in afterwards
+    _buffer.assign(BinaryTaglist::RECORD_HEADER_SIZE, '\0');
+    BinaryTaglist::encode(taglist, _buffer);
+
+    const size_t payloadSize = _buffer.size() - BinaryTaglist::RECORD_HEADER_SIZE;
+    if (payloadSize > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("taglist of frame " + std::to_string(frameNumber) + " is too large");
+    }
+
+    std::string header;
+    ByteWriter writer(header);
+    writer.u64(frameNumber);
+    writer.u32(static_cast<uint32_t>(payloadSize));
+    writer.u32(BinaryTaglist::checksum(_buffer.data() + BinaryTaglist::RECORD_HEADER_SIZE, payloadSize));
+    _buffer.replace(0, header.size(), header);
+
+    _stream.write(_buffer.data(), _buffer.size());
+    _stream.flush();
+    if (!_stream) {
+        throw std::runtime_error("unable to write taglist of frame " + std::to_string(frameNumber));
+    }
+}
+
+const uint32_t BinaryTaglistReader::INDEX_VERSION;
+
+BinaryTaglistReader::BinaryTaglistReader(const std::string &path)
+    : _path(path),
+      _indexPath(path + ".idx"),
+      _index(nullptr),
+      _numFrames(0),
+      _validSize(0),
+      _numScannedRecords(0) {
+    // an empty file can not be mapped
+    boost::system::error_code error;
+    const uint64_t fileSize = boost::filesystem::file_size(path, error);
+    if (error) {
+        throw std::runtime_error("unable to open binary taglist file " + path);
+    }
+    if (fileSize < BinaryTaglist::HEADER_SIZE) {
+        throw std::runtime_error(path + " is not a binary taglist file");
+    }
+
+    _file.open(path);
+    const char *data = _file.data();
+    const size_t size = _file.size();
+
+    if (std::memcmp(data, BinaryTaglist::MAGIC, sizeof(BinaryTaglist::MAGIC))) {
+        throw std::runtime_error(path + " is not a binary taglist file");
+    }
+    if (loadU32(data + sizeof(BinaryTaglist::MAGIC)) != BinaryTaglist::VERSION) {
+        throw std::runtime_error("unsupported version of binary taglist file " + path);
+    }
+
+    IndexHeader header;
+    if (!openIndex(header)) {
+        std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+        header.version            = INDEX_VERSION;
+        header.reserved           = 0;
+        header.indexedSize        = BinaryTaglist::HEADER_SIZE;
+        header.lastRecordOffset   = 0;
+        header.lastRecordChecksum = 0;
+        header.reserved2          = 0;
+        header.numFrames          = 0;
+    }
+
+    // only the record headers after the indexed ones are read, the last record may be incomplete
+    std::vector<IndexEntry> tail;
+    uint64_t offset = header.indexedSize;
+    while (offset + BinaryTaglist::RECORD_HEADER_SIZE <= size) {
+        const char *recordHeader = data + offset;
+
+        IndexEntry entry;
+        entry.frameNumber = loadU64(recordHeader);
+        entry.offset      = offset + BinaryTaglist::RECORD_HEADER_SIZE;
+        entry.size        = loadU32(recordHeader + 8);
+        entry.checksum    = loadU32(recordHeader + 12);
+
+        if (entry.offset + entry.size > size) {
+            break;
+        }
+
+        tail.push_back(entry);
+        header.lastRecordOffset   = offset;
+        header.lastRecordChecksum = entry.checksum;
+        offset = entry.offset + entry.size;
+    }
+    _validSize         = offset;
+    _numScannedRecords = tail.size();
+
+    if (tail.empty()) {
+        return;
+    }
+
+    // keep only the last record of every frame, records in the tail replace indexed ones
+    std::vector<IndexEntry> index(_index, _index + _numFrames);
+    index.insert(index.end(), tail.begin(), tail.end());
+    std::stable_sort(index.begin(), index.end(), [](IndexEntry const & lhs, IndexEntry const & rhs) {
+        return lhs.frameNumber < rhs.frameNumber;
+    });
+    auto last = index.begin();
+    for (auto it = index.begin(); it != index.end(); ++it) {
+        const auto next = std::next(it);
+        if (next == index.end() || next->frameNumber != it->frameNumber) {
+            *last++ = *it;
+        }
+    }
+    index.erase(last, index.end());
+
+    header.indexedSize = _validSize;
+    header.numFrames   = index.size();
+
+    _indexFile.close();
+    try {
+        writeIndex(_indexPath, header, index);
+        IndexHeader written;
+        if (openIndex(written)) {
+            return;
+        }
+    } catch (std::ios_base::failure const &) {
+    } catch (boost::filesystem::filesystem_error const &) {
+    }
+
+    // e.g. the directory is not writable
+    _ownedIndex = std::move(index);
+    _ownedIndex.shrink_to_fit();
+    _index      = _ownedIndex.data();
+    _numFrames  = _ownedIndex.size();
+}
+
+bool BinaryTaglistReader::openIndex(IndexHeader &header) {
+    boost::system::error_code error;
+    if (!boost::filesystem::is_regular_file(_indexPath, error) ||
+            boost::filesystem::file_size(_indexPath, error) < sizeof(IndexHeader)) {
+        return false;
+    }
+
+    boost::iostreams::mapped_file_source file;
+    try {
+        file.open(_indexPath);
+    } catch (std::ios_base::failure const &) {
+        return false;
+    }
+
+    std::memcpy(&header, file.data(), sizeof(IndexHeader));
+    if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) || header.version != INDEX_VERSION) {
+        return false;
+    }
+    if (header.numFrames > (file.size() - sizeof(IndexHeader)) / sizeof(IndexEntry)) {
+        return false;
+    }
+
+    // the indexed records have to be unchanged, i.e. the last one has to be in place
+    if (header.indexedSize < BinaryTaglist::HEADER_SIZE || header.indexedSize > _file.size()) {
+        return false;
+    }
+    if (header.numFrames) {
+        if (header.lastRecordOffset + BinaryTaglist::RECORD_HEADER_SIZE > header.indexedSize) {
+            return false;
+        }
+        const char *recordHeader = _file.data() + header.lastRecordOffset;
+        if (header.lastRecordOffset + BinaryTaglist::RECORD_HEADER_SIZE + loadU32(recordHeader + 8) !=
+                header.indexedSize || loadU32(recordHeader + 12) != header.lastRecordChecksum) {
+            return false;
+        }
+    } else if (header.indexedSize != BinaryTaglist::HEADER_SIZE) {
+        return false;
+    }
+
+    _indexFile = file;
+    _index     = reinterpret_cast<const IndexEntry *>(_indexFile.data() + sizeof(IndexHeader));
+    _numFrames = static_cast<size_t>(header.numFrames);
+
+    return true;
+}
+
+void BinaryTaglistReader::writeIndex(const std::string &indexPath, const IndexHeader &header,
+                                     const std::vector<IndexEntry> &index) {
+    // written to a temporary file first, an index that is being written is never opened
+    const std::string tempPath = indexPath + ".tmp";
+    {
+        std::ofstream os;
+        os.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+        os.open(tempPath, std::ios::binary | std::ios::trunc);
+        os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(IndexEntry));
+    }
+    boost::filesystem::rename(tempPath, indexPath);
+}
+
+std::vector<size_t> BinaryTaglistReader::getFrameNumbers() const {
+    std::vector<size_t> frameNumbers;
+    frameNumbers.reserve(_numFrames);
+    for (size_t idx = 0; idx < _numFrames; ++idx) {
+        frameNumbers.push_back(static_cast<size_t>(_index[idx].frameNumber));
+    }
+    return frameNumbers;
+}
+
+bool BinaryTaglistReader::hasFrame(const size_t frameNumber) const {
+    return findFrame(frameNumber) != nullptr;
+}
+
+taglist_t BinaryTaglistReader::read(const size_t frameNumber) const {
+    const IndexEntry *entry = findFrame(frameNumber);
+    if (!entry) {
+        throw std::out_of_range("no taglist of frame " + std::to_string(frameNumber) + " in " + _path);
+    }
+
+    const char *payload = _file.data() + entry->offset;
+    if (BinaryTaglist::checksum(payload, entry->size) != entry->checksum) {
+        throw std::runtime_error("corrupt taglist of frame " + std::to_string(frameNumber) + " in " + _path);
+    }
+
+    return BinaryTaglist::decode(payload, entry->size);
+}
+
+const BinaryTaglistReader::IndexEntry *BinaryTaglistReader::findFrame(const size_t frameNumber) const {
+    const IndexEntry *end = _index + _numFrames;
+    const IndexEntry *it = std::lower_bound(_index, end, frameNumber, [](IndexEntry const & entry, size_t number) {
+        return entry.frameNumber < number;
+    });
+
+    if (it == end || it->frameNumber != frameNumber) {
+        return nullptr;
+    }
+    return it;
+}
+
+}
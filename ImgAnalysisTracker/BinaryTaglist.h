@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <pipeline/datastructure/Tag.h>
+#include <pipeline/datastructure/TagCandidate.h>
+#include <pipeline/datastructure/PipelineGrid.h>
+
+#include "BatchRunner.h"
+#include "Common.h"
+
+/**
+ * compact, append-only binary format for the taglists of many frames.
+ *
+ * All values are stored little-endian. The file starts with a header (magic "BBTAGLST",
+ * uint32 version, uint32 reserved), followed by one record per written frame:
+ *
+ *   uint64 frame number, uint32 payload size, uint32 FNV-1a checksum of the payload
+ *   payload: uint32 number of tags, then per tag
+ *     int32 roi x, y, width, height, uint64 id, uint8 flags (1: valid), uint16 number of candidates
+ *     per candidate: int32 vote, center x, y, axis width, height, float32 angle, int32 roi width,
+ *       height, uint16 number of grids, uint16 number of decodings
+ *       per grid: int32 center x, y, float32 radius, z, y and x rotation
+ *       per decoding: uint16 bits
+ *
+ * Candidates, grids and decodings are stored in the order of the pipeline, i.e. best
+ * first. A frame may be written several times, the last record of a frame is used.
+ * Images (e.g. the original sub images of the tags) are not stored.
+ *
+ * The frame index of a file is kept in a separate file, see BinaryTaglistReader.
+ */
+namespace BinaryTaglist {
+
+static const char MAGIC[8] = { 'B', 'B', 'T', 'A', 'G', 'L', 'S', 'T' };
+static const uint32_t VERSION = 1;
+static const size_t HEADER_SIZE = 16;
+static const size_t RECORD_HEADER_SIZE = 16;
+
+/**
+ * append the payload of a record to buffer
+ */
+void encode(BeesBookCommon::taglist_t const &taglist, std::string &buffer);
+
+/**
+ * @throw std::runtime_error if the payload is incomplete
+ */
+BeesBookCommon::taglist_t decode(const char *data, size_t size);
+
+uint32_t checksum(const char *data, size_t size);
+}
+
+namespace Batch {
+
+/**
+ * appends the taglist of every frame to a binary taglist file, see BinaryTaglist.
+ *
+ * An existing file is continued. An incomplete record at its end (e.g. after a crash)
+ * is removed first. Every record is flushed to the operating system once written.
+ * The appended records are added to the frame index by the next BinaryTaglistReader.
+ */
+class BinaryTaglistWriter : public TaglistWriter {
+  public:
+    explicit BinaryTaglistWriter(std::string const &path);
+    void write(size_t frameNumber, BeesBookCommon::taglist_t const &taglist) override;
+
+  private:
+    std::ofstream _stream;
+    // reused for the records of all frames
+    std::string _buffer;
+};
+
+/**
+ * random access to the frames of a binary taglist file.
+ *
+ * The file is memory mapped. The frame number -> record index is persisted next to the
+ * file (<file>.idx) and memory mapped as well, so opening the file only reads the record
+ * headers written after the index was last updated, and accessing a frame only touches
+ * the pages of its index entry and its record. Whenever records had to be scanned, the
+ * index file is updated. If it can not be written, the index is kept in memory.
+ * Records appended after opening the file are not seen.
+ *
+ * All methods are thread safe.
+ */
+class BinaryTaglistReader {
+  public:
+    explicit BinaryTaglistReader(std::string const &path);
+
+    BinaryTaglistReader(BinaryTaglistReader const &) = delete;
+    BinaryTaglistReader &operator=(BinaryTaglistReader const &) = delete;
+
+    /**
+     * @return sorted numbers of all frames with a complete record
+     */
+    std::vector<size_t> getFrameNumbers() const;
+    size_t getNumFrames() const { return _numFrames; }
+    bool hasFrame(size_t frameNumber) const;
+
+    /**
+     * @return taglist of the last record of the frame
+     * @throw std::out_of_range if there is no record of the frame
+     * @throw std::runtime_error if the record is corrupt
+     */
+    BeesBookCommon::taglist_t read(size_t frameNumber) const;
+
+    /**
+     * @return size of the file up to the end of the last complete record
+     */
+    uint64_t getValidSize() const { return _validSize; }
+
+    /**
+     * @return number of record headers read when opening the file, i.e. of the records
+     *         that were not in the index file
+     */
+    size_t getNumScannedRecords() const { return _numScannedRecords; }
+
+    std::string const &getIndexPath() const { return _indexPath; }
+
+  private:
+    static const uint32_t INDEX_VERSION = 1;
+
+    struct IndexHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        // size of the taglist file up to the end of the last indexed record
+        uint64_t indexedSize;
+        // header of the last indexed record, to detect a replaced taglist file
+        uint64_t lastRecordOffset;
+        uint32_t lastRecordChecksum;
+        uint32_t reserved2;
+        uint64_t numFrames;
+    };
+
+    struct IndexEntry {
+        uint64_t frameNumber;
+        // of the payload, relative to the beginning of the file
+        uint64_t offset;
+        uint32_t size;
+        uint32_t checksum;
+    };
+
+    std::string _path;
+    std::string _indexPath;
+    boost::iostreams::mapped_file_source _file;
+    boost::iostreams::mapped_file_source _indexFile;
+    // only used if the index file can not be written
+    std::vector<IndexEntry> _ownedIndex;
+    // one entry per frame, sorted by frame number. Points into the index file or _ownedIndex
+    const IndexEntry *_index;
+    size_t _numFrames;
+    uint64_t _validSize;
+    size_t _numScannedRecords;
+
+    // map the index file, if it is valid for the taglist file
+    bool openIndex(IndexHeader &header);
+    static void writeIndex(std::string const &indexPath, IndexHeader const &header,
+                           std::vector<IndexEntry> const &index);
+    const IndexEntry *findFrame(size_t frameNumber) const;
+};
+
+}
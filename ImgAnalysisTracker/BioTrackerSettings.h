@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+
+#include <biotracker/settings/Settings.h>
+
+#include "Common.h"
+
+namespace BC = BioTracker::Core;
+
+/**
+ * conversion between the BioTracker settings and the pipeline settings, only
+ * used by the BioTracker plugin (the batch runner reads pipeline configs directly)
+ */
+namespace BeesBookCommon {
+
+pipeline::settings::localizer_settings_t getLocalizerSettings(BC::Settings &settings);
+pipeline::settings::ellipsefitter_settings_t getEllipseFitterSettings(BC::Settings &settings);
+pipeline::settings::gridfitter_settings_t getGridfitterSettings(BC::Settings &settings);
+pipeline::settings::preprocessor_settings_t getPreprocessorSettings(BC::Settings &settings);
+
+namespace Params {
+// settings of the tracker itself, i.e. not of one of the pipeline stages
+static const std::string BASE = "BEESBOOKPIPELINE.TRACKER.";
+// threads used by the ellipsefitter, gridfitter and decoder (0: number of hardware threads)
+static const std::string NUM_THREADS = "NUM_THREADS";
+// binary taglist file the results of all tracked frames are appended to (empty: disabled)
+static const std::string RESULT_FILE = "RESULT_FILE";
+// directory the output of every tracked stage is written to, see StageCheckpoint.h (empty: disabled)
+static const std::string CHECKPOINT_DIRECTORY = "CHECKPOINT_DIRECTORY";
+}
+
+pipeline_settings_t getPipelineSettings(BC::Settings &settings);
+size_t getNumThreads(BC::Settings &settings);
+std::string getResultFile(BC::Settings &settings);
+std::string getCheckpointDirectory(BC::Settings &settings);
+
+void setPreprocessorSettings(BC::Settings &bioTrackerSettings,
+                             pipeline::settings::preprocessor_settings_t &settings);
+void setLocalizerSettings(BC::Settings &bioTrackerSettings,
+                          pipeline::settings::localizer_settings_t &settings);
+void setEllipseFitterSettings(BC::Settings &bioTrackerSettings,
+                              pipeline::settings::ellipsefitter_settings_t &settings);
+void setGridFitterSettings(BC::Settings &bioTrackerSettings,
+                           pipeline::settings::gridfitter_settings_t &settings);
+void setPipelineSettings(BC::Settings &bioTrackerSettings,
+                         pipeline_settings_t &settings);
+}
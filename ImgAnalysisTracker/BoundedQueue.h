@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+struct QueueStatistics {
+    size_t capacity;
+    size_t size;
+    size_t maxSize;
+    size_t numPushed;
+    // average queue size seen by the producer right after a push
+    double averageSize;
+    double pushStallMs;
+    double popStallMs;
+};
+
+/**
+ * blocking FIFO queue with a fixed capacity for passing work between threads.
+ *
+ * Producers block in push() while the queue is full, consumers block in pop()
+ * while it is empty. The time spent waiting on either side is recorded, so a
+ * full queue with a high push stall time points to a slow consumer and vice versa.
+ */
+template <typename T>
+class BoundedQueue {
+  public:
+    explicit BoundedQueue(size_t capacity)
+        : _capacity(std::max<size_t>(capacity, 1)),
+          _closed(false),
+          _maxSize(0),
+          _numPushed(0),
+          _cumulSize(0),
+          _pushStall(steady_clock_t::duration::zero()),
+          _popStall(steady_clock_t::duration::zero()) {
+    }
+
+    /**
+     * @return false if the queue has been closed, the value is dropped in this case
+     */
+    bool push(T &&value) {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (_queue.size() >= _capacity && !_closed) {
+            const auto start = steady_clock_t::now();
+            _notFull.wait(lock, [&]() { return _queue.size() < _capacity || _closed; });
+            _pushStall += steady_clock_t::now() - start;
+        }
+
+        if (_closed) {
+            return false;
+        }
+
+        _queue.push_back(std::move(value));
+
+        ++_numPushed;
+        _cumulSize += _queue.size();
+        _maxSize = std::max(_maxSize, _queue.size());
+
+        lock.unlock();
+        _notEmpty.notify_one();
+
+        return true;
+    }
+
+    /**
+     * @return false if the queue has been closed and all remaining values have been consumed
+     */
+    bool pop(T &value) {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (_queue.empty() && !_closed) {
+            const auto start = steady_clock_t::now();
+            _notEmpty.wait(lock, [&]() { return !_queue.empty() || _closed; });
+            _popStall += steady_clock_t::now() - start;
+        }
+
+        if (_queue.empty()) {
+            return false;
+        }
+
+        value = std::move(_queue.front());
+        _queue.pop_front();
+
+        lock.unlock();
+        _notFull.notify_one();
+
+        return true;
+    }
+
+    /**
+     * wake up all waiting threads. Values that are already queued can still be popped.
+     */
+    void close() {
+        {
+            const std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _notFull.notify_all();
+        _notEmpty.notify_all();
+    }
+
+    QueueStatistics getStatistics() const {
+        const std::lock_guard<std::mutex> lock(_mutex);
+
+        typedef std::chrono::duration<double, std::milli> ms_t;
+
+        QueueStatistics statistics;
+        statistics.capacity    = _capacity;
+        statistics.size        = _queue.size();
+        statistics.maxSize     = _maxSize;
+        statistics.numPushed   = _numPushed;
+        statistics.averageSize = _numPushed ? static_cast<double>(_cumulSize) / _numPushed : 0.;
+        statistics.pushStallMs = std::chrono::duration_cast<ms_t>(_pushStall).count();
+        statistics.popStallMs  = std::chrono::duration_cast<ms_t>(_popStall).count();
+        return statistics;
+    }
+
+  private:
+    typedef std::chrono::steady_clock steady_clock_t;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _notFull;
+    std::condition_variable _notEmpty;
+    std::deque<T> _queue;
+
+    const size_t _capacity;
+    bool _closed;
+
+    size_t _maxSize;
+    size_t _numPushed;
+    size_t _cumulSize;
+    steady_clock_t::duration _pushStall;
+    steady_clock_t::duration _popStall;
+};
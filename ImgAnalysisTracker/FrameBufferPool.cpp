@@ -0,0 +1,75 @@
+#include "FrameBufferPool.h"
+
+#include <algorithm>
+
+FrameBufferPool::FrameBufferPool(const size_t maxBuffers)
+    : _maxBuffers(maxBuffers),
+      _hits(0),
+      _misses(0),
+      _bytes(0),
+      _peakBytes(0) {
+}
+
+cv::Mat FrameBufferPool::acquire(const cv::Size &size, const int type) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    for (const cv::Mat &buffer : _buffers) {
+        if (buffer.size() == size && buffer.type() == type && !isInUse(buffer)) {
+            ++_hits;
+            return buffer;
+        }
+    }
+
+    ++_misses;
+
+    // make room by dropping buffers of other sizes that are not used anymore
+    if (_buffers.size() >= _maxBuffers) {
+        releaseFreeBuffers(_maxBuffers - 1);
+    }
+
+    _buffers.emplace_back(size, type);
+    _bytes += getNumBytes(_buffers.back());
+    _peakBytes = std::max(_peakBytes, _bytes);
+
+    return _buffers.back();
+}
+
+cv::Mat FrameBufferPool::clone(const cv::Mat &image) {
+    cv::Mat buffer = acquire(image.size(), image.type());
+    image.copyTo(buffer);
+    return buffer;
+}
+
+FrameBufferPool::Statistics FrameBufferPool::getStatistics() const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return { _hits, _misses, _buffers.size(), _bytes, _peakBytes };
+}
+
+void FrameBufferPool::trim() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    releaseFreeBuffers(0);
+}
+
+void FrameBufferPool::releaseFreeBuffers(const size_t maxBuffers) {
+    for (auto it = _buffers.begin(); it != _buffers.end() && _buffers.size() > maxBuffers;) {
+        if (isInUse(*it)) {
+            ++it;
+        } else {
+            _bytes -= getNumBytes(*it);
+            it = _buffers.erase(it);
+        }
+    }
+}
+
+bool FrameBufferPool::isInUse(const cv::Mat &buffer) {
+    // the reference held by the pool itself is not counted
+#if CV_MAJOR_VERSION >= 3
+    return buffer.u && buffer.u->refcount > 1;
+#else
+    return buffer.refcount && *buffer.refcount > 1;
+#endif
+}
+
+size_t FrameBufferPool::getNumBytes(const cv::Mat &buffer) {
+    return buffer.total() * buffer.elemSize();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * reuses the per-frame image buffers across frames.
+ *
+ * The pool keeps a reference to every buffer it hands out. A buffer is free again
+ * as soon as all other cv::Mat headers referring to it are gone, so buffers can be
+ * stored or passed to other threads like any other cv::Mat without being overwritten
+ * while they are still in use.
+ *
+ * acquire() and clone() are thread safe.
+ */
+class FrameBufferPool {
+  public:
+    struct Statistics {
+        // requests served by a free buffer of the same size and type
+        size_t hits;
+        // requests that needed a new allocation
+        size_t misses;
+        size_t numBuffers;
+        // bytes currently owned by the pool
+        size_t bytes;
+        size_t peakBytes;
+    };
+
+    /**
+     * @param maxBuffers free buffers are released when the pool holds more buffers
+     */
+    explicit FrameBufferPool(size_t maxBuffers = 32);
+
+    FrameBufferPool(FrameBufferPool const &) = delete;
+    FrameBufferPool &operator=(FrameBufferPool const &) = delete;
+
+    /**
+     * @return buffer of the given size and type, its content is undefined
+     */
+    cv::Mat acquire(cv::Size const &size, int type);
+
+    /**
+     * @return deep copy of image stored in a pooled buffer
+     */
+    cv::Mat clone(cv::Mat const &image);
+
+    Statistics getStatistics() const;
+
+    /**
+     * release all buffers that are not in use
+     */
+    void trim();
+
+  private:
+    const size_t _maxBuffers;
+
+    mutable std::mutex _mutex;
+    std::vector<cv::Mat> _buffers;
+
+    size_t _hits;
+    size_t _misses;
+    size_t _bytes;
+    size_t _peakBytes;
+
+    static bool isInUse(cv::Mat const &buffer);
+    static size_t getNumBytes(cv::Mat const &buffer);
+    void releaseFreeBuffers(size_t maxBuffers);
+};
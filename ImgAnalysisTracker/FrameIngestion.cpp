@@ -0,0 +1,135 @@
+#include "FrameIngestion.h"
+
+#include <map>
+#include <stdexcept>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+FrameIngestion::FrameIngestion(const FrameFormat format)
+    : _format(format) {
+}
+
+bool FrameIngestion::toGray(const cv::Mat &frame, cv::Mat &frameGray) const {
+    const FrameFormat format = resolveFormat(frame);
+
+    const auto requireType = [&](int type) {
+        if (frame.type() != type) {
+            throw std::invalid_argument("frame type does not match the configured input format");
+        }
+    };
+
+    switch (format) {
+    case FrameFormat::Gray:
+        requireType(CV_8UC1);
+        frameGray = frame;
+        return true;
+    case FrameFormat::BGR:
+        requireType(CV_8UC3);
+        // for identical channels the weighted sum equals the first channel
+        if (_format != FrameFormat::Auto || !extractMonoBGR(frame, frameGray)) {
+            cv::cvtColor(frame, frameGray, CV_BGR2GRAY);
+        }
+        return false;
+    case FrameFormat::MonoBGR:
+        requireType(CV_8UC3);
+        cv::extractChannel(frame, frameGray, 0);
+        return false;
+    case FrameFormat::BGRA:
+        requireType(CV_8UC4);
+        cv::cvtColor(frame, frameGray, CV_BGRA2GRAY);
+        return false;
+    case FrameFormat::BayerBG:
+        requireType(CV_8UC1);
+        cv::cvtColor(frame, frameGray, CV_BayerBG2GRAY);
+        return false;
+    case FrameFormat::BayerGB:
+        requireType(CV_8UC1);
+        cv::cvtColor(frame, frameGray, CV_BayerGB2GRAY);
+        return false;
+    case FrameFormat::BayerRG:
+        requireType(CV_8UC1);
+        cv::cvtColor(frame, frameGray, CV_BayerRG2GRAY);
+        return false;
+    case FrameFormat::BayerGR:
+        requireType(CV_8UC1);
+        cv::cvtColor(frame, frameGray, CV_BayerGR2GRAY);
+        return false;
+    case FrameFormat::Mono12:
+        requireType(CV_16UC1);
+        frame.convertTo(frameGray, CV_8U, 1. / 16.);
+        return false;
+    case FrameFormat::Mono16:
+        requireType(CV_16UC1);
+        frame.convertTo(frameGray, CV_8U, 1. / 256.);
+        return false;
+    default:
+        throw std::invalid_argument("unsupported frame format");
+    }
+}
+
+FrameFormat FrameIngestion::resolveFormat(const cv::Mat &frame) const {
+    if (_format != FrameFormat::Auto) {
+        return _format;
+    }
+
+    switch (frame.type()) {
+    case CV_8UC1:
+        return FrameFormat::Gray;
+    case CV_8UC3:
+        // expanded mono frames are detected by toGray() while converting
+        return FrameFormat::BGR;
+    case CV_8UC4:
+        return FrameFormat::BGRA;
+    case CV_16UC1:
+        // the number of significant bits can not be derived from a single frame, and guessing
+        // scales 12 bit data 16 times too dark
+        throw std::invalid_argument("16 bit frames need an explicit input format "
+                                    "(--input-format mono12 or mono16)");
+    default:
+        throw std::invalid_argument("unsupported frame type " + std::to_string(frame.type()));
+    }
+}
+
+bool FrameIngestion::requiresRawFrames() const {
+    return (_format != FrameFormat::Auto) && (_format != FrameFormat::BGR) &&
+           (_format != FrameFormat::MonoBGR) && (_format != FrameFormat::BGRA);
+}
+
+FrameFormat FrameIngestion::parseFormat(const std::string &name) {
+    static const std::map<std::string, FrameFormat> formats {
+        { "auto",     FrameFormat::Auto },
+        { "gray",     FrameFormat::Gray },
+        { "bgr",      FrameFormat::BGR },
+        { "mono-bgr", FrameFormat::MonoBGR },
+        { "bgra",     FrameFormat::BGRA },
+        { "bayer-bg", FrameFormat::BayerBG },
+        { "bayer-gb", FrameFormat::BayerGB },
+        { "bayer-rg", FrameFormat::BayerRG },
+        { "bayer-gr", FrameFormat::BayerGR },
+        { "mono12",   FrameFormat::Mono12 },
+        { "mono16",   FrameFormat::Mono16 }
+    };
+
+    const auto it = formats.find(name);
+    if (it == formats.end()) {
+        throw std::invalid_argument("unknown input format " + name);
+    }
+    return it->second;
+}
+
+bool FrameIngestion::extractMonoBGR(const cv::Mat &frame, cv::Mat &frameGray) {
+    frameGray.create(frame.size(), CV_8UC1);
+
+    for (int y = 0; y < frame.rows; ++y) {
+        const cv::Vec3b *row = frame.ptr<cv::Vec3b>(y);
+        uchar *grayRow = frameGray.ptr<uchar>(y);
+        for (int x = 0; x < frame.cols; ++x) {
+            const cv::Vec3b &pixel = row[x];
+            if (pixel[0] != pixel[1] || pixel[0] != pixel[2]) {
+                return false;
+            }
+            grayRow[x] = pixel[0];
+        }
+    }
+    return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * pixel format of the frames passed to the pipeline
+ */
+enum class FrameFormat : uint8_t {
+    // decided per frame from the cv::Mat type (raw Bayer and 16 bit mono have to be selected
+    // explicitly)
+    Auto = 0,
+    // 8 bit grayscale
+    Gray,
+    // 8 bit BGR color
+    BGR,
+    // 8 bit grayscale expanded to three identical channels
+    MonoBGR,
+    // 8 bit BGRA color
+    BGRA,
+    // 8 bit raw Bayer patterns
+    BayerBG,
+    BayerGB,
+    BayerRG,
+    BayerGR,
+    // 16 bit containers with 12 or 16 significant bits
+    Mono12,
+    Mono16
+};
+
+/**
+ * converts camera frames to the 8 bit grayscale image the preprocessor expects,
+ * choosing the cheapest conversion for the frame type:
+ *
+ *  - 8 bit gray is passed through without copying
+ *  - BGR frames whose channels are identical (mono cameras expanded by the video
+ *    reader) only have one channel extracted instead of a weighted sum. With Auto,
+ *    every pixel is compared while extracting, a color frame falls back to the
+ *    weighted sum
+ *  - raw Bayer frames are demosaiced directly to luma
+ *  - 12/16 bit mono frames are scaled and saturated to 8 bit in one pass
+ */
+class FrameIngestion {
+  public:
+    explicit FrameIngestion(FrameFormat format = FrameFormat::Auto);
+
+    /**
+     * @param frame camera frame
+     * @param frameGray 8 bit grayscale result
+     * @return true if frameGray shares its buffer with frame
+     */
+    bool toGray(cv::Mat const &frame, cv::Mat &frameGray) const;
+
+    /**
+     * @return true if toGray() passes the frame through instead of writing into frameGray,
+     *         i.e. a buffer for frameGray is only needed if this returns false
+     */
+    bool sharesBuffer(cv::Mat const &frame) const { return resolveFormat(frame) == FrameFormat::Gray; }
+
+    /**
+     * @return format that is used for the given frame
+     */
+    FrameFormat resolveFormat(cv::Mat const &frame) const;
+
+    FrameFormat getFormat() const { return _format; }
+
+    /**
+     * @return true if the frames have to be read without converting them to BGR
+     *         (e.g. Bayer or 16 bit cameras), see Batch::FrameSource
+     */
+    bool requiresRawFrames() const;
+
+    /**
+     * @param name one of auto, gray, bgr, mono-bgr, bgra, bayer-bg, bayer-gb, bayer-rg,
+     *        bayer-gr, mono12, mono16
+     */
+    static FrameFormat parseFormat(std::string const &name);
+
+  private:
+    const FrameFormat _format;
+
+    /**
+     * extract the first channel of a BGR frame while checking that all channels are identical
+     *
+     * @return false if any pixel has different channels, frameGray is incomplete in that case
+     */
+    static bool extractMonoBGR(cv::Mat const &frame, cv::Mat &frameGray);
+};
@@ -0,0 +1,137 @@
+#include "FrameParallelPipeline.h"
+
+#include "ThreadPool.h"
+
+using namespace BeesBookCommon;
+
+FrameParallelPipeline::FrameParallelPipeline(const pipeline_settings_t &settings, frame_source_t source,
+                                             const Stage lastStage, const size_t numInstances,
+                                             const size_t queueCapacity, const size_t numThreads,
+                                             const boost::optional<TilingOptions> &tiling)
+    : _lastStage(lastStage),
+      _source(std::move(source)),
+      _nextOutput(0) {
+    const size_t num = ThreadPool::resolveNumThreads(numInstances);
+    for (size_t idx = 0; idx < num; ++idx) {
+        _instances.push_back(std::make_unique<Instance>(settings, queueCapacity, numThreads, tiling));
+    }
+
+    _threads.emplace_back(&FrameParallelPipeline::runSource, this);
+    for (size_t idx = 0; idx < _instances.size(); ++idx) {
+        _threads.emplace_back(&FrameParallelPipeline::runInstance, this, idx);
+    }
+}
+
+FrameParallelPipeline::~FrameParallelPipeline() {
+    shutdown();
+}
+
+bool FrameParallelPipeline::pop(size_t &frameNumber, taglist_t &taglist) {
+    Job job;
+    if (!_instances[_nextOutput]->output.pop(job)) {
+        shutdown();
+
+        const std::lock_guard<std::mutex> lock(_errorMutex);
+        if (_error) {
+            std::rethrow_exception(_error);
+        }
+        return false;
+    }
+    _nextOutput = (_nextOutput + 1) % _instances.size();
+
+    frameNumber = job.frameNumber;
+    taglist     = std::move(job.taglist);
+    return true;
+}
+
+std::vector<FrameParallelPipeline::InstanceStatistics> FrameParallelPipeline::getStatistics() const {
+    typedef std::chrono::duration<double, std::milli> ms_t;
+
+    std::vector<InstanceStatistics> statistics;
+
+    const std::lock_guard<std::mutex> lock(_statisticsMutex);
+    for (const std::unique_ptr<Instance> &instance : _instances) {
+        statistics.push_back({ instance->numFrames,
+                               std::chrono::duration_cast<ms_t>(instance->busy).count(),
+                               instance->input.getStatistics(),
+                               instance->output.getStatistics() });
+    }
+
+    return statistics;
+}
+
+void FrameParallelPipeline::runSource() {
+    try {
+        size_t instanceIdx = 0;
+        Job job;
+        while (_source(job.frameNumber, job.frameGray)) {
+            if (!_instances[instanceIdx]->input.push(std::move(job))) {
+                break;
+            }
+            job = Job();
+            instanceIdx = (instanceIdx + 1) % _instances.size();
+        }
+    } catch (...) {
+        setError(std::current_exception());
+    }
+
+    for (const std::unique_ptr<Instance> &instance : _instances) {
+        instance->input.close();
+    }
+}
+
+void FrameParallelPipeline::runInstance(const size_t instanceIdx) {
+    Instance &instance = *_instances[instanceIdx];
+
+    try {
+        Job job;
+        while (instance.input.pop(job)) {
+            const auto start = std::chrono::steady_clock::now();
+            job.taglist = instance.pipeline.process(job.frameGray, _lastStage);
+            job.frameGray.release();
+            const auto end = std::chrono::steady_clock::now();
+
+            {
+                const std::lock_guard<std::mutex> lock(_statisticsMutex);
+                ++instance.numFrames;
+                instance.busy += end - start;
+            }
+
+            if (!instance.output.push(std::move(job))) {
+                break;
+            }
+        }
+    } catch (...) {
+        setError(std::current_exception());
+    }
+
+    instance.output.close();
+}
+
+void FrameParallelPipeline::setError(std::exception_ptr error) {
+    {
+        const std::lock_guard<std::mutex> lock(_errorMutex);
+        if (!_error) {
+            _error = error;
+        }
+    }
+
+    // abort all other workers
+    closeQueues();
+}
+
+void FrameParallelPipeline::closeQueues() {
+    for (const std::unique_ptr<Instance> &instance : _instances) {
+        instance->input.close();
+        instance->output.close();
+    }
+}
+
+void FrameParallelPipeline::shutdown() {
+    closeQueues();
+    for (std::thread &thread : _threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "BoundedQueue.h"
+#include "Common.h"
+#include "PipelineInstance.h"
+
+/**
+ * frame-parallel execution: N independent pipeline instances are created from one
+ * settings snapshot and whole frames are handed out to them round-robin.
+ *
+ * Every instance has its own input and output queue. Because the frames are
+ * distributed round-robin, the results are merged back into frame order by popping
+ * the output queues in the same round-robin order.
+ */
+class FrameParallelPipeline {
+  public:
+    /**
+     * @return false if there are no frames left
+     */
+    typedef std::function<bool(size_t &frameNumber, cv::Mat &frameGray)> frame_source_t;
+
+    struct InstanceStatistics {
+        size_t numFrames;
+        double busyMs;
+        QueueStatistics inputQueue;
+        QueueStatistics outputQueue;
+    };
+
+    /**
+     * @param numInstances number of pipeline instances, 0 selects the number of hardware threads
+     * @param queueCapacity capacity of the input and output queue of every instance
+     * @param numThreads number of threads used by the per-tag stages of each instance
+     * @param tiling tiled localization within each instance, see TiledLocalizer
+     */
+    FrameParallelPipeline(BeesBookCommon::pipeline_settings_t const &settings, frame_source_t source,
+                          BeesBookCommon::Stage lastStage, size_t numInstances, size_t queueCapacity,
+                          size_t numThreads = 1, boost::optional<TilingOptions> const &tiling = boost::none);
+    ~FrameParallelPipeline();
+
+    FrameParallelPipeline(FrameParallelPipeline const &) = delete;
+    FrameParallelPipeline &operator=(FrameParallelPipeline const &) = delete;
+
+    /**
+     * blocks until the result of the next frame (in source order) is available.
+     * Rethrows exceptions that occurred in one of the workers.
+     *
+     * @return false if all frames have been processed
+     */
+    bool pop(size_t &frameNumber, BeesBookCommon::taglist_t &taglist);
+
+    size_t getNumInstances() const { return _instances.size(); }
+
+    std::vector<InstanceStatistics> getStatistics() const;
+
+  private:
+    struct Job {
+        size_t frameNumber;
+        cv::Mat frameGray;
+        BeesBookCommon::taglist_t taglist;
+    };
+
+    typedef BoundedQueue<Job> queue_t;
+
+    struct Instance {
+        Instance(BeesBookCommon::pipeline_settings_t const &settings, size_t queueCapacity,
+                 size_t numThreads, boost::optional<TilingOptions> const &tiling)
+            : pipeline(settings, numThreads, tiling),
+              input(queueCapacity),
+              output(queueCapacity),
+              numFrames(0),
+              busy(std::chrono::steady_clock::duration::zero()) {}
+
+        PipelineInstance pipeline;
+        queue_t input;
+        queue_t output;
+        size_t numFrames;
+        std::chrono::steady_clock::duration busy;
+    };
+
+    const BeesBookCommon::Stage _lastStage;
+    frame_source_t _source;
+
+    std::vector<std::unique_ptr<Instance>> _instances;
+    std::vector<std::thread> _threads;
+
+    // instance whose output queue holds the next frame in source order
+    size_t _nextOutput;
+
+    mutable std::mutex _statisticsMutex;
+    std::mutex _errorMutex;
+    std::exception_ptr _error;
+
+    void runSource();
+    void runInstance(size_t instanceIdx);
+    void setError(std::exception_ptr error);
+    void closeQueues();
+    void shutdown();
+};
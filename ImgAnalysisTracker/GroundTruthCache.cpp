@@ -0,0 +1,288 @@
+#include "GroundTruthCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+
+#include <cereal/archives/json.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+
+namespace {
+const char CACHE_MAGIC[8] = { 'B', 'B', 'G', 'T', 'C', 'A', 'C', 'H' };
+}
+
+const uint32_t GroundTruthCache::VERSION;
+
+GroundTruthCache::GroundTruthCache(const std::string &groundTruthPath)
+    : _rebuilt(false),
+      _index(nullptr),
+      _numFrames(0) {
+    if (!boost::filesystem::is_regular_file(groundTruthPath)) {
+        throw std::runtime_error("unable to open ground truth file " + groundTruthPath);
+    }
+
+    Source source;
+    source.path             = groundTruthPath;
+    source.size             = boost::filesystem::file_size(groundTruthPath);
+    source.modificationTime = static_cast<int64_t>(boost::filesystem::last_write_time(groundTruthPath));
+
+    // the cache in the temporary directory is named after the full path, it does not
+    // depend on the contents of the file
+    std::stringstream tempName;
+    tempName << boost::filesystem::path(groundTruthPath).filename().string() << "." << std::hex
+             << std::hash<std::string>()(boost::filesystem::absolute(groundTruthPath).string()) << ".gtcache";
+
+    const std::vector<std::string> cachePaths {
+        groundTruthPath + ".gtcache",
+        (boost::filesystem::temp_directory_path() / tempName.str()).string()
+    };
+
+    for (const std::string &cachePath : cachePaths) {
+        if (open(cachePath, source)) {
+            return;
+        }
+    }
+
+    // the cache is missing or outdated, use the first location that is writable
+    for (const std::string &cachePath : cachePaths) {
+        try {
+            build(source, cachePath);
+        } catch (std::ios_base::failure const &) {
+            continue;
+        } catch (boost::filesystem::filesystem_error const &) {
+            continue;
+        }
+
+        if (open(cachePath, source)) {
+            _rebuilt = true;
+            return;
+        }
+    }
+
+    throw std::runtime_error("unable to create ground truth cache for " + groundTruthPath);
+}
+
+std::vector<size_t> GroundTruthCache::getFrameNumbers() const {
+    std::vector<size_t> frameNumbers;
+    frameNumbers.reserve(_numFrames);
+    for (size_t idx = 0; idx < _numFrames; ++idx) {
+        frameNumbers.push_back(static_cast<size_t>(_index[idx].frameNumber));
+    }
+    return frameNumbers;
+}
+
+bool GroundTruthCache::hasFrame(const size_t frameNumber) const {
+    return findFrame(frameNumber) != nullptr;
+}
+
+std::shared_ptr<const BC::Serialization::Data> GroundTruthCache::getFrame(const size_t frameNumber) const {
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        const auto it = _frames.find(frameNumber);
+        if (it != _frames.end()) {
+            return it->second;
+        }
+    }
+
+    const std::shared_ptr<BC::Serialization::Data> data = std::make_shared<BC::Serialization::Data>();
+
+    // decoded without holding the lock, frames may be requested by several threads
+    const IndexEntry *entry = findFrame(frameNumber);
+    if (entry) {
+        boost::iostreams::stream<boost::iostreams::array_source> is(_file.data() + entry->offset,
+                static_cast<size_t>(entry->size));
+        cereal::JSONInputArchive ar(is);
+        ar(*data);
+    }
+
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _frames.emplace(frameNumber, data).first->second;
+}
+
+uint64_t GroundTruthCache::hashFile(const std::string &path) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+
+    if (boost::filesystem::file_size(path) == 0) {
+        return hash;
+    }
+
+    const boost::iostreams::mapped_file_source file(path);
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(file.data());
+    for (size_t idx = 0; idx < file.size(); ++idx) {
+        hash ^= data[idx];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+uint64_t GroundTruthCache::Source::getHash() {
+    if (!hash) {
+        hash = hashFile(path);
+    }
+    return hash.get();
+}
+
+void GroundTruthCache::build(Source &source, const std::string &cachePath) {
+    BC::Serialization::Data data;
+    {
+        std::ifstream is(source.path);
+        cereal::JSONInputArchive ar(is);
+        ar(data);
+    }
+
+    // split the tracked objects by frame
+    std::map<size_t, std::vector<BC::TrackedObject>> objectsByFrame;
+    for (const BC::TrackedObject &object : data.getTrackedObjects()) {
+        for (size_t frameNumber = 0; frameNumber <= object.maximumFrameNumber(); ++frameNumber) {
+            if (object.count(frameNumber)) {
+                std::vector<BC::TrackedObject> &objects = objectsByFrame[frameNumber];
+                objects.emplace_back(object.getId());
+                objects.back().add(frameNumber, object.get<BC::ObjectModel>(frameNumber));
+            }
+        }
+    }
+
+    // the annotations are stored in the same format as in the .tdat file, the grid
+    // types are only registered for polymorphic serialization with the JSON archive.
+    // Only the tracked objects are used by the ground truth evaluation.
+    std::vector<std::string> payloads;
+    payloads.reserve(objectsByFrame.size());
+    for (const auto &frame : objectsByFrame) {
+        const BC::Serialization::Data frameData(std::string(), std::string(), std::vector<std::string>(),
+                                                frame.second);
+        std::ostringstream os;
+        {
+            cereal::JSONOutputArchive ar(os);
+            ar(frameData);
+        }
+        payloads.push_back(os.str());
+    }
+
+    Header header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version                = VERSION;
+    header.reserved               = 0;
+    header.sourceHash             = source.getHash();
+    header.sourceSize             = source.size;
+    header.sourceModificationTime = source.modificationTime;
+    header.numFrames              = objectsByFrame.size();
+
+    std::vector<IndexEntry> index;
+    uint64_t offset = sizeof(Header) + objectsByFrame.size() * sizeof(IndexEntry);
+    size_t payloadIdx = 0;
+    for (const auto &frame : objectsByFrame) {
+        const uint64_t size = payloads[payloadIdx++].size();
+        index.push_back({ frame.first, offset, size });
+        offset += size;
+    }
+
+    // written to a temporary file first, a cache that is being written is never opened
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream os;
+        os.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+        os.open(tempPath, std::ios::binary | std::ios::trunc);
+        os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(IndexEntry));
+        for (const std::string &payload : payloads) {
+            os.write(payload.data(), payload.size());
+        }
+    }
+    boost::filesystem::rename(tempPath, cachePath);
+}
+
+void GroundTruthCache::rewriteHeader(const std::string &cachePath, const boost::iostreams::mapped_file_source &file,
+                                     const Header &header) {
+    // same as build(), the index and the annotations are copied from the mapped file
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream os;
+        os.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+        os.open(tempPath, std::ios::binary | std::ios::trunc);
+        os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        os.write(file.data() + sizeof(Header), file.size() - sizeof(Header));
+    }
+    boost::filesystem::rename(tempPath, cachePath);
+}
+
+bool GroundTruthCache::open(const std::string &cachePath, Source &source) {
+    boost::system::error_code error;
+    if (!boost::filesystem::is_regular_file(cachePath, error) ||
+            boost::filesystem::file_size(cachePath, error) < sizeof(Header)) {
+        return false;
+    }
+
+    boost::iostreams::mapped_file_source file;
+    try {
+        file.open(cachePath);
+    } catch (std::ios_base::failure const &) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) || header.version != VERSION) {
+        return false;
+    }
+
+    // the file is only hashed if it may have changed
+    const bool sourceChanged = header.sourceSize != source.size ||
+                               header.sourceModificationTime != source.modificationTime;
+    if (sourceChanged && header.sourceHash != source.getHash()) {
+        return false;
+    }
+
+    if (header.numFrames > file.size() / sizeof(IndexEntry)) {
+        return false;
+    }
+    const uint64_t indexEnd = sizeof(Header) + header.numFrames * sizeof(IndexEntry);
+    if (indexEnd > file.size()) {
+        return false;
+    }
+
+    const IndexEntry *index = reinterpret_cast<const IndexEntry *>(file.data() + sizeof(Header));
+    for (size_t idx = 0; idx < header.numFrames; ++idx) {
+        if (index[idx].offset < indexEnd || index[idx].offset + index[idx].size > file.size()) {
+            return false;
+        }
+    }
+
+    // the contents are unchanged (e.g. the file has been touched or copied), store the new size
+    // and modification time so that it is not hashed again. The cache is usable either way
+    if (sourceChanged) {
+        header.sourceSize             = source.size;
+        header.sourceModificationTime = source.modificationTime;
+        try {
+            rewriteHeader(cachePath, file, header);
+        } catch (std::ios_base::failure const &) {
+        } catch (boost::filesystem::filesystem_error const &) {
+        }
+    }
+
+    _file      = file;
+    _index     = reinterpret_cast<const IndexEntry *>(_file.data() + sizeof(Header));
+    _numFrames = static_cast<size_t>(header.numFrames);
+    _cachePath = cachePath;
+
+    return true;
+}
+
+const GroundTruthCache::IndexEntry *GroundTruthCache::findFrame(const size_t frameNumber) const {
+    const IndexEntry *end = _index + _numFrames;
+    const IndexEntry *it = std::lower_bound(_index, end, frameNumber, [](IndexEntry const & entry, size_t number) {
+        return entry.frameNumber < number;
+    });
+
+    if (it == end || it->frameNumber != frameNumber) {
+        return nullptr;
+    }
+    return it;
+}
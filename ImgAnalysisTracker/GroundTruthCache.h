@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/optional.hpp>
+
+#include <biotracker/serialization/SerializationData.h>
+
+#include "Common.h"
+
+namespace BC = BioTracker::Core;
+
+/**
+ * binary sidecar cache of a ground truth (.tdat) file.
+ *
+ * Parsing and converting a large .tdat file takes a long time. The cache splits the
+ * annotations by frame and stores them next to the .tdat file (<file>.gtcache), keyed
+ * by the size, modification time and hash of the .tdat file. The cache is memory mapped,
+ * opening it only reads the header and the frame index, the annotations of a frame are
+ * decoded on first access.
+ *
+ * The .tdat file is only hashed if its size or modification time differ from the ones
+ * stored in the cache. The cache is rebuilt whenever the hash has changed, otherwise only
+ * its header is updated with the new size and modification time. If the
+ * directory of the .tdat file is not writable, it is stored in the temporary directory
+ * instead.
+ *
+ * All methods are thread safe.
+ */
+class GroundTruthCache {
+  public:
+    /**
+     * @param groundTruthPath .tdat file
+     */
+    explicit GroundTruthCache(std::string const &groundTruthPath);
+
+    GroundTruthCache(GroundTruthCache const &) = delete;
+    GroundTruthCache &operator=(GroundTruthCache const &) = delete;
+
+    /**
+     * @return sorted numbers of all frames with at least one annotated tag
+     */
+    std::vector<size_t> getFrameNumbers() const;
+
+    bool hasFrame(size_t frameNumber) const;
+
+    /**
+     * @return annotations of the given frame, empty if the frame has not been annotated
+     */
+    std::shared_ptr<const BC::Serialization::Data> getFrame(size_t frameNumber) const;
+
+    std::string const &getCachePath() const { return _cachePath; }
+
+    /**
+     * @return true if the cache had to be (re)built from the .tdat file
+     */
+    bool wasRebuilt() const { return _rebuilt; }
+
+  private:
+    static const uint32_t VERSION = 2;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        // seconds since the epoch
+        int64_t sourceModificationTime;
+        uint64_t numFrames;
+    };
+
+    // size and modification time of the .tdat file, and its hash once it has been computed
+    struct Source {
+        std::string path;
+        uint64_t size;
+        int64_t modificationTime;
+        boost::optional<uint64_t> hash;
+
+        uint64_t getHash();
+    };
+
+    struct IndexEntry {
+        uint64_t frameNumber;
+        // of the serialized annotations, relative to the beginning of the file
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    std::string _cachePath;
+    bool _rebuilt;
+
+    boost::iostreams::mapped_file_source _file;
+    // points into the mapped file, sorted by frame number
+    const IndexEntry *_index;
+    size_t _numFrames;
+
+    mutable std::mutex _mutex;
+    mutable std::map<size_t, std::shared_ptr<const BC::Serialization::Data>> _frames;
+
+    static uint64_t hashFile(std::string const &path);
+    static void build(Source &source, std::string const &cachePath);
+    // replace the header of the mapped cache file, the rest is copied unchanged
+    static void rewriteHeader(std::string const &cachePath, boost::iostreams::mapped_file_source const &file,
+                              Header const &header);
+
+    bool open(std::string const &cachePath, Source &source);
+    const IndexEntry *findFrame(size_t frameNumber) const;
+};
@@ -0,0 +1,94 @@
+#include "LatestJobWorker.h"
+
+LatestJobWorker::LatestJobWorker(busy_callback_t onBusyChanged)
+    : _running(false),
+      _busyNotified(false),
+      _stop(false),
+      _onBusyChanged(std::move(onBusyChanged)),
+      _thread(&LatestJobWorker::run, this) {
+}
+
+LatestJobWorker::~LatestJobWorker() {
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _pendingJob = nullptr;
+        if (_runningCancelled) {
+            _runningCancelled->store(true);
+        }
+    }
+    _condition.notify_all();
+
+    _thread.join();
+}
+
+void LatestJobWorker::submit(job_t job) {
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _pendingJob = std::move(job);
+        if (_runningCancelled) {
+            _runningCancelled->store(true);
+        }
+    }
+    _condition.notify_all();
+}
+
+void LatestJobWorker::cancel() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _pendingJob = nullptr;
+    if (_runningCancelled) {
+        _runningCancelled->store(true);
+    }
+}
+
+bool LatestJobWorker::isBusy() const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _running || _pendingJob;
+}
+
+void LatestJobWorker::run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (true) {
+        _condition.wait(lock, [&]() { return _stop || _pendingJob; });
+        if (_stop) {
+            return;
+        }
+
+        job_t job = std::move(_pendingJob);
+        _pendingJob = nullptr;
+        _runningCancelled = std::make_shared<std::atomic<bool>>(false);
+        _running = true;
+
+        const CancellationToken token(_runningCancelled);
+        const bool becameBusy = !_busyNotified;
+        _busyNotified = true;
+
+        lock.unlock();
+
+        if (becameBusy && _onBusyChanged) {
+            _onBusyChanged(true);
+        }
+
+        try {
+            job(token);
+        } catch (CancelledException const &) {
+            // a newer job has been submitted or the worker is shutting down
+        }
+
+        lock.lock();
+
+        _running = false;
+        _runningCancelled.reset();
+
+        if (!_pendingJob && !_stop) {
+            _busyNotified = false;
+
+            lock.unlock();
+            if (_onBusyChanged) {
+                _onBusyChanged(false);
+            }
+            lock.lock();
+        }
+    }
+}
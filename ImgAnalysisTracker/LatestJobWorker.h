@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+/**
+ * thrown by CancellationToken::throwIfCancelled()
+ */
+struct CancelledException : public std::runtime_error {
+    CancelledException() : std::runtime_error("job cancelled") {}
+};
+
+/**
+ * handed to a running job. Jobs poll the token at safe points (e.g. between pipeline
+ * stages) and stop as soon as a newer job has been submitted.
+ */
+class CancellationToken {
+  public:
+    explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> cancelled)
+        : _cancelled(std::move(cancelled)) {}
+
+    bool isCancelled() const { return _cancelled->load(); }
+
+    void throwIfCancelled() const {
+        if (isCancelled()) {
+            throw CancelledException();
+        }
+    }
+
+  private:
+    std::shared_ptr<const std::atomic<bool>> _cancelled;
+};
+
+/**
+ * executes jobs on a dedicated thread with latest-wins semantics: submitting a job
+ * cancels the running job and replaces a job that has not been started yet.
+ *
+ * Jobs may only throw CancelledException, any other exception has to be handled
+ * by the job itself.
+ */
+class LatestJobWorker {
+  public:
+    typedef std::function<void(CancellationToken const &)> job_t;
+    // called from the worker thread when it starts working or becomes idle
+    typedef std::function<void(bool busy)> busy_callback_t;
+
+    explicit LatestJobWorker(busy_callback_t onBusyChanged = busy_callback_t());
+    ~LatestJobWorker();
+
+    LatestJobWorker(LatestJobWorker const &) = delete;
+    LatestJobWorker &operator=(LatestJobWorker const &) = delete;
+
+    void submit(job_t job);
+
+    /**
+     * cancel the running job and drop the pending one
+     */
+    void cancel();
+
+    /**
+     * @return true if a job is running or pending
+     */
+    bool isBusy() const;
+
+  private:
+    mutable std::mutex _mutex;
+    std::condition_variable _condition;
+
+    job_t _pendingJob;
+    std::shared_ptr<std::atomic<bool>> _runningCancelled;
+    bool _running;
+    bool _busyNotified;
+    bool _stop;
+
+    const busy_callback_t _onBusyChanged;
+
+    // has to be initialized last
+    std::thread _thread;
+
+    void run();
+};
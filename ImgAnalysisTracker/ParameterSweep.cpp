@@ -0,0 +1,557 @@
+#include "ParameterSweep.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <groundtruth/converter.h>
+
+#include "BoundedQueue.h"
+#include "GroundTruthCache.h"
+#include "PipelineInstance.h"
+#include "ThreadPool.h"
+
+using namespace BeesBookCommon;
+
+namespace Batch {
+
+namespace {
+typedef std::vector<size_t> combination_t;
+
+/**
+ * sweep parameters of one stage and all combinations of their values
+ */
+struct StageGroup {
+    // indices of the sweep parameters
+    std::vector<size_t> parameters;
+    // value indices of the parameters above
+    std::vector<combination_t> combinations;
+    // base config with the values of each combination
+    std::vector<pipeline_settings_t> settings;
+};
+
+struct ConfigurationTotals {
+    EvaluationSummary summary;
+    double processingMs = 0.;
+};
+
+bool startsWith(std::string const &value, std::string const &prefix) {
+    return value.compare(0, prefix.size(), prefix) == 0;
+}
+
+Stage getParameterStage(std::string const &path) {
+    if (startsWith(path, pipeline::settings::Preprocessor::Params::BASE) ||
+            startsWith(path, pipeline::settings::Localizer::Params::BASE)) {
+        return Stage::Localizer;
+    }
+    if (startsWith(path, pipeline::settings::EllipseFitter::Params::BASE)) {
+        return Stage::EllipseFitter;
+    }
+    if (startsWith(path, pipeline::settings::Gridfitter::Params::BASE)) {
+        return Stage::GridFitter;
+    }
+    throw std::invalid_argument("sweep parameter " + path + " is not a pipeline setting");
+}
+
+bool isIntegral(const double value) {
+    return std::floor(value) == value;
+}
+
+std::vector<std::string> getRangeValues(std::string const &path, const double min, const double max,
+                                        const double step) {
+    if (step <= 0. || max < min) {
+        throw std::invalid_argument("invalid range of sweep parameter " + path);
+    }
+
+    // integer ranges are written as integers, the settings of integer type can not be parsed otherwise
+    const bool integral = isIntegral(min) && isIntegral(max) && isIntegral(step);
+    const size_t numValues = static_cast<size_t>(std::floor((max - min) / step + 1e-9)) + 1;
+
+    std::vector<std::string> values;
+    for (size_t idx = 0; idx < numValues; ++idx) {
+        const double value = min + static_cast<double>(idx) * step;
+        std::ostringstream os;
+        if (integral) {
+            os << std::llround(value);
+        } else {
+            os << std::setprecision(12) << value;
+        }
+        values.push_back(os.str());
+    }
+    return values;
+}
+
+std::vector<combination_t> getCombinations(std::vector<SweepParameter> const &parameters,
+        std::vector<size_t> const &parameterIndices) {
+    std::vector<combination_t> combinations(1);
+    for (const size_t parameterIdx : parameterIndices) {
+        std::vector<combination_t> extended;
+        for (const combination_t &combination : combinations) {
+            for (size_t valueIdx = 0; valueIdx < parameters[parameterIdx].values.size(); ++valueIdx) {
+                extended.push_back(combination);
+                extended.back().push_back(valueIdx);
+            }
+        }
+        combinations = std::move(extended);
+    }
+    return combinations;
+}
+
+void applyValues(std::vector<SweepParameter> const &parameters, StageGroup const &group,
+                 combination_t const &combination, boost::property_tree::ptree &config) {
+    for (size_t idx = 0; idx < group.parameters.size(); ++idx) {
+        const SweepParameter &parameter = parameters[group.parameters[idx]];
+        config.put(parameter.path, parameter.values[combination[idx]]);
+    }
+}
+
+pipeline_settings_t loadSettings(boost::property_tree::ptree const &config) {
+    // the settings can only be loaded from a file
+    const boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+                                         boost::filesystem::unique_path("bbsweep-%%%%-%%%%-%%%%.json");
+    boost::property_tree::write_json(path.string(), config);
+
+    pipeline_settings_t settings;
+    try {
+        settings = loadPipelineSettings(path.string());
+    } catch (...) {
+        boost::filesystem::remove(path);
+        throw;
+    }
+    boost::filesystem::remove(path);
+
+    return settings;
+}
+
+double fScore(SweepResult const &result) {
+    const double sum = result.recall() + result.precision();
+    return sum > 0. ? 2. * result.recall() * result.precision() / sum : 0.;
+}
+
+void writeSweepJson(SweepOptions const &options, std::vector<SweepResult> const &results, const size_t best,
+                    const double seconds, std::ostream &stream) {
+    stream << std::setprecision(6);
+    stream << "{\n"
+           << "  \"config\": \"" << escapeJson(options.configPath) << "\",\n"
+           << "  \"sweep\": \"" << escapeJson(options.sweepPath) << "\",\n"
+           << "  \"video\": \"" << escapeJson(options.inputPath) << "\",\n"
+           << "  \"groundTruth\": \"" << escapeJson(options.groundTruthPath) << "\",\n"
+           << "  \"numFrames\": " << (results.empty() ? 0 : results.front().summary.numFrames) << ",\n"
+           << "  \"seconds\": " << seconds << ",\n"
+           << "  \"best\": " << best << ",\n"
+           << "  \"configurations\": [";
+
+    for (size_t idx = 0; idx < results.size(); ++idx) {
+        const SweepResult &result = results[idx];
+        stream << (idx ? ",\n" : "\n") << "    {\n"
+               << "      \"index\": " << idx << ",\n"
+               << "      \"parameters\": {";
+        for (size_t valueIdx = 0; valueIdx < result.values.size(); ++valueIdx) {
+            stream << (valueIdx ? ", " : " ") << "\"" << escapeJson(result.values[valueIdx].first) << "\": \""
+                   << escapeJson(result.values[valueIdx].second) << "\"";
+        }
+        stream << " },\n"
+               << "      \"paretoOptimal\": " << (result.paretoOptimal ? "true" : "false") << ",\n"
+               << "      \"recall\": " << result.recall() << ",\n"
+               << "      \"precision\": " << result.precision() << ",\n"
+               << "      \"msPerFrame\": " << result.msPerFrame() << ",\n"
+               << "      \"localizer\": { \"precision\": " << result.summary.localizer.precision()
+               << ", \"recall\": " << result.summary.localizer.recall() << " },\n"
+               << "      \"ellipsefitter\": { \"precision\": " << result.summary.ellipsefitter.precision()
+               << ", \"recall\": " << result.summary.ellipsefitter.recall() << " },\n"
+               << "      \"decoder\": { \"results\": " << result.summary.decoder.numResults
+               << ", \"matches\": " << result.summary.decoder.numMatches
+               << ", \"averageHamming\": " << result.summary.decoder.averageHamming() << " }\n"
+               << "    }";
+    }
+
+    stream << "\n  ]\n}\n";
+}
+
+void writeSweepCsv(std::vector<SweepParameter> const &parameters, std::vector<SweepResult> const &results,
+                   std::ostream &stream) {
+    stream << std::setprecision(6);
+
+    stream << "index";
+    for (const SweepParameter &parameter : parameters) {
+        stream << ',' << parameter.path;
+    }
+    stream << ",localizer_precision,localizer_recall,ellipsefitter_precision,ellipsefitter_recall"
+           << ",gridfitter_precision,gridfitter_recall,decoder_matches,decoder_avg_hamming,ms_per_frame,pareto\n";
+
+    for (size_t idx = 0; idx < results.size(); ++idx) {
+        const SweepResult &result = results[idx];
+        stream << idx;
+        for (const auto &value : result.values) {
+            stream << ',' << value.second;
+        }
+        stream << ',' << result.summary.localizer.precision() << ',' << result.summary.localizer.recall()
+               << ',' << result.summary.ellipsefitter.precision() << ',' << result.summary.ellipsefitter.recall()
+               << ',' << result.precision() << ',' << result.recall()
+               << ',' << result.summary.decoder.numMatches << ',' << result.summary.decoder.averageHamming()
+               << ',' << result.msPerFrame() << ',' << (result.paretoOptimal ? 1 : 0) << '\n';
+    }
+}
+}
+
+std::vector<SweepParameter> loadSweepParameters(const std::string &path) {
+    boost::property_tree::ptree tree;
+    boost::property_tree::read_json(path, tree);
+
+    std::vector<SweepParameter> parameters;
+    for (const auto &entry : tree) {
+        SweepParameter parameter;
+        parameter.path  = entry.first;
+        parameter.stage = getParameterStage(parameter.path);
+
+        const boost::property_tree::ptree &node = entry.second;
+        if (node.empty()) {
+            parameter.values.push_back(node.data());
+        } else if (node.count("min")) {
+            parameter.values = getRangeValues(parameter.path, node.get<double>("min"), node.get<double>("max"),
+                                              node.get<double>("step", 1.));
+        } else {
+            // JSON arrays are stored as children without a key
+            for (const auto &value : node) {
+                if (!value.first.empty()) {
+                    throw std::invalid_argument("invalid values of sweep parameter " + parameter.path);
+                }
+                parameter.values.push_back(value.second.data());
+            }
+        }
+
+        parameters.push_back(std::move(parameter));
+    }
+
+    if (parameters.empty()) {
+        throw std::invalid_argument("no sweep parameters in " + path);
+    }
+
+    return parameters;
+}
+
+double SweepResult::msPerFrame() const {
+    return summary.numFrames ? processingMs / static_cast<double>(summary.numFrames) : 0.;
+}
+
+void markParetoFront(std::vector<SweepResult> &results) {
+    for (SweepResult &result : results) {
+        result.paretoOptimal = std::none_of(results.begin(), results.end(), [&](SweepResult const & other) {
+            const bool notWorse = other.recall() >= result.recall() && other.precision() >= result.precision() &&
+                                  other.msPerFrame() <= result.msPerFrame();
+            const bool better   = other.recall() > result.recall() || other.precision() > result.precision() ||
+                                  other.msPerFrame() < result.msPerFrame();
+            return notWorse && better;
+        });
+    }
+}
+
+std::vector<SweepResult> runSweep(const SweepOptions &options, std::ostream &log) {
+    const std::vector<SweepParameter> parameters = loadSweepParameters(options.sweepPath);
+
+    // the base config is stored in the same format as exported by the tracker
+    pipeline_settings_t baseSettings = loadPipelineSettings(options.configPath);
+    boost::property_tree::ptree baseConfig = baseSettings.preprocessor.getPTree();
+    baseSettings.localizer.addToPTree(baseConfig);
+    baseSettings.ellipsefitter.addToPTree(baseConfig);
+    baseSettings.gridfitter.addToPTree(baseConfig);
+
+    // localizer, ellipsefitter and gridfitter settings are combined independently
+    std::array<StageGroup, 3> groups;
+    const std::array<Stage, 3> groupStages { Stage::Localizer, Stage::EllipseFitter, Stage::GridFitter };
+    for (size_t groupIdx = 0; groupIdx < groups.size(); ++groupIdx) {
+        StageGroup &group = groups[groupIdx];
+        for (size_t parameterIdx = 0; parameterIdx < parameters.size(); ++parameterIdx) {
+            if (parameters[parameterIdx].stage == groupStages[groupIdx]) {
+                group.parameters.push_back(parameterIdx);
+            }
+        }
+        group.combinations = getCombinations(parameters, group.parameters);
+
+        for (const combination_t &combination : group.combinations) {
+            boost::property_tree::ptree config = baseConfig;
+            applyValues(parameters, group, combination, config);
+            group.settings.push_back(loadSettings(config));
+        }
+    }
+
+    const StageGroup &localizerGroup     = groups[0];
+    const StageGroup &ellipsefitterGroup = groups[1];
+    const StageGroup &gridfitterGroup    = groups[2];
+    const size_t numLocalizer     = localizerGroup.combinations.size();
+    const size_t numEllipsefitter = ellipsefitterGroup.combinations.size();
+    const size_t numGridfitter    = gridfitterGroup.combinations.size();
+    const size_t numConfigurations = numLocalizer * numEllipsefitter * numGridfitter;
+
+    const auto getConfigurationIdx = [&](const size_t localizerIdx, const size_t ellipsefitterIdx,
+    const size_t gridfitterIdx) {
+        return (localizerIdx * numEllipsefitter + ellipsefitterIdx) * numGridfitter + gridfitterIdx;
+    };
+
+    log << numConfigurations << " configurations (" << numLocalizer << " localizer, " << numEllipsefitter
+        << " ellipsefitter, " << numGridfitter << " gridfitter settings)" << std::endl;
+
+    const std::shared_ptr<const GroundTruthCache> groundTruth =
+        std::make_shared<GroundTruthCache>(options.groundTruthPath);
+    std::vector<size_t> annotatedFrames = groundTruth->getFrameNumbers();
+    if (options.maxFrames && annotatedFrames.size() > options.maxFrames.get()) {
+        annotatedFrames.resize(options.maxFrames.get());
+    }
+    log << annotatedFrames.size() << " annotated frames in " << options.groundTruthPath
+        << " (cache " << groundTruth->getCachePath() << ")" << std::endl;
+
+    struct Job {
+        size_t frameNumber;
+        cv::Mat frameGray;
+        size_t localizerIdx;
+    };
+
+    BoundedQueue<Job> queue(options.queueCapacity);
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    const size_t numInstances = std::max<size_t>(1, std::min(ThreadPool::resolveNumThreads(options.numInstances),
+                                annotatedFrames.size() * numLocalizer));
+    log << "Running " << numInstances << " pipeline instances" << std::endl;
+
+    // every thread sums up the results of its frames, they are combined at the end
+    std::vector<std::vector<ConfigurationTotals>> totals(numInstances,
+            std::vector<ConfigurationTotals>(numConfigurations));
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t instanceIdx = 0; instanceIdx < numInstances; ++instanceIdx) {
+        threads.emplace_back([&, instanceIdx]() {
+            try {
+                const auto elapsedMs = [](std::chrono::steady_clock::time_point const & since) {
+                    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+                };
+
+                std::vector<ConfigurationTotals> &threadTotals = totals[instanceIdx];
+                PipelineInstance pipeline(baseSettings, 1, options.tiling);
+                TagStageExecutor &tagStages = pipeline.getTagStages();
+
+                // settings are only reloaded when they change
+                const size_t none = std::numeric_limits<size_t>::max();
+                size_t loadedLocalizer     = none;
+                size_t loadedEllipsefitter = none;
+                size_t loadedGridfitter    = none;
+
+                Job job;
+                while (queue.pop(job)) {
+                    if (job.localizerIdx != loadedLocalizer) {
+                        pipeline.loadSettings(localizerGroup.settings[job.localizerIdx].preprocessor);
+                        pipeline.loadSettings(localizerGroup.settings[job.localizerIdx].localizer);
+                        loadedLocalizer = job.localizerIdx;
+                    }
+
+                    const std::shared_ptr<const BC::Serialization::Data> annotations =
+                        groundTruth->getFrame(job.frameNumber);
+
+                    // the frame is shared by the jobs of all localizer configurations
+                    auto stageStart = std::chrono::steady_clock::now();
+                    const taglist_t localizerTaglist =
+                        pipeline.localize(numLocalizer > 1 ? job.frameGray.clone() : job.frameGray);
+                    const double localizerMs = elapsedMs(stageStart);
+
+                    for (size_t ellipsefitterIdx = 0; ellipsefitterIdx < numEllipsefitter; ++ellipsefitterIdx) {
+                        if (ellipsefitterIdx != loadedEllipsefitter) {
+                            tagStages.loadSettings(ellipsefitterGroup.settings[ellipsefitterIdx].ellipsefitter);
+                            loadedEllipsefitter = ellipsefitterIdx;
+                        }
+
+                        stageStart = std::chrono::steady_clock::now();
+                        const taglist_t ellipsefitterTaglist = tagStages.processEllipseFitter(taglist_t(localizerTaglist));
+                        const double ellipsefitterMs = elapsedMs(stageStart);
+
+                        for (size_t gridfitterIdx = 0; gridfitterIdx < numGridfitter; ++gridfitterIdx) {
+                            if (gridfitterIdx != loadedGridfitter) {
+                                tagStages.loadSettings(gridfitterGroup.settings[gridfitterIdx].gridfitter);
+                                loadedGridfitter = gridfitterIdx;
+                            }
+
+                            // the evaluation keeps references to the taglists, the later stages
+                            // have to replace the evaluated ellipsefitter taglist
+                            GroundTruthEvaluation evaluation(gtConverter::ResultsFromSerializationData(*annotations));
+                            evaluation.evaluateLocalizer(job.frameNumber, localizerTaglist);
+
+                            taglist_t taglist = ellipsefitterTaglist;
+                            evaluation.evaluateEllipseFitter(taglist);
+
+                            stageStart = std::chrono::steady_clock::now();
+                            taglist = tagStages.processGridFitter(std::move(taglist));
+                            const double gridfitterMs = elapsedMs(stageStart);
+                            evaluation.evaluateGridFitter();
+
+                            stageStart = std::chrono::steady_clock::now();
+                            taglist = tagStages.processDecoder(std::move(taglist));
+                            const double decoderMs = elapsedMs(stageStart);
+                            evaluation.evaluateDecoder();
+
+                            FrameEvaluation frame;
+                            frame.frameNumber  = job.frameNumber;
+                            frame.processingMs = localizerMs + ellipsefitterMs + gridfitterMs + decoderMs;
+                            countEvaluation(evaluation, frame);
+
+                            ConfigurationTotals &configuration =
+                                threadTotals[getConfigurationIdx(job.localizerIdx, ellipsefitterIdx, gridfitterIdx)];
+                            configuration.summary.add(frame);
+                            configuration.processingMs += frame.processingMs;
+                        }
+                    }
+                }
+            } catch (...) {
+                {
+                    const std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+                // abort the other instances and the frame source
+                queue.close();
+            }
+        });
+    }
+
+    // every frame is decoded once and evaluated for all localizer configurations
+    try {
+        readFrames(options.inputPath, options.inputFormat, annotatedFrames,
+        [&](const size_t frameNumber, const cv::Mat & frameGray) {
+            for (size_t localizerIdx = 0; localizerIdx < numLocalizer; ++localizerIdx) {
+                if (!queue.push(Job { frameNumber, frameGray, localizerIdx })) {
+                    return false;
+                }
+            }
+            return true;
+        }, options.logInterval, log);
+    } catch (...) {
+        const std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+
+    queue.close();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<SweepResult> results(numConfigurations);
+    for (size_t localizerIdx = 0; localizerIdx < numLocalizer; ++localizerIdx) {
+        for (size_t ellipsefitterIdx = 0; ellipsefitterIdx < numEllipsefitter; ++ellipsefitterIdx) {
+            for (size_t gridfitterIdx = 0; gridfitterIdx < numGridfitter; ++gridfitterIdx) {
+                SweepResult &result = results[getConfigurationIdx(localizerIdx, ellipsefitterIdx, gridfitterIdx)];
+
+                // parameters in the order of the sweep file
+                std::vector<size_t> valueIndices(parameters.size());
+                for (const auto &selected : {
+                            std::make_pair(&localizerGroup, localizerIdx),
+                            std::make_pair(&ellipsefitterGroup, ellipsefitterIdx),
+                            std::make_pair(&gridfitterGroup, gridfitterIdx)
+                        }) {
+                    const StageGroup &group = *selected.first;
+                    for (size_t idx = 0; idx < group.parameters.size(); ++idx) {
+                        valueIndices[group.parameters[idx]] = group.combinations[selected.second][idx];
+                    }
+                }
+                for (size_t parameterIdx = 0; parameterIdx < parameters.size(); ++parameterIdx) {
+                    result.values.emplace_back(parameters[parameterIdx].path,
+                                               parameters[parameterIdx].values[valueIndices[parameterIdx]]);
+                }
+            }
+        }
+    }
+
+    for (const std::vector<ConfigurationTotals> &threadTotals : totals) {
+        for (size_t configurationIdx = 0; configurationIdx < numConfigurations; ++configurationIdx) {
+            SweepResult &result = results[configurationIdx];
+            const ConfigurationTotals &configuration = threadTotals[configurationIdx];
+
+            const size_t numFrames = result.summary.numFrames + configuration.summary.numFrames;
+            result.summary.localizer     += configuration.summary.localizer;
+            result.summary.ellipsefitter += configuration.summary.ellipsefitter;
+            result.summary.gridfitter    += configuration.summary.gridfitter;
+            result.summary.decoder       += configuration.summary.decoder;
+            result.summary.numFrames = numFrames;
+            result.summary.seconds   = seconds;
+            result.processingMs += configuration.processingMs;
+        }
+    }
+
+    markParetoFront(results);
+
+    // the best configuration of the pareto front regarding the f1 score of the detections
+    size_t best = 0;
+    for (size_t idx = 1; idx < results.size(); ++idx) {
+        const SweepResult &result = results[idx];
+        const double score     = fScore(result);
+        const double bestScore = fScore(results[best]);
+        if (result.paretoOptimal && (!results[best].paretoOptimal || score > bestScore ||
+                                     (score == bestScore && result.msPerFrame() < results[best].msPerFrame()))) {
+            best = idx;
+        }
+    }
+
+    std::ofstream json(options.outputPath + ".json");
+    if (!json) {
+        throw std::runtime_error("unable to open output file " + options.outputPath + ".json");
+    }
+    writeSweepJson(options, results, best, seconds, json);
+
+    std::ofstream csv(options.outputPath + ".csv");
+    if (!csv) {
+        throw std::runtime_error("unable to open output file " + options.outputPath + ".csv");
+    }
+    writeSweepCsv(parameters, results, csv);
+
+    // written in the format of exported configurations, it can be loaded by the tracker
+    {
+        boost::property_tree::ptree bestConfig = baseConfig;
+        size_t parameterIdx = 0;
+        for (const auto &value : results[best].values) {
+            bestConfig.put(parameters[parameterIdx++].path, value.second);
+        }
+        boost::property_tree::write_json(options.outputPath + ".best.json", bestConfig);
+    }
+
+    log << "Evaluated " << numConfigurations << " configurations on " << annotatedFrames.size()
+        << " frames in " << seconds << "s" << std::endl
+        << "Pareto front (recall, precision, ms per frame):" << std::endl;
+    for (size_t idx = 0; idx < results.size(); ++idx) {
+        const SweepResult &result = results[idx];
+        if (!result.paretoOptimal) {
+            continue;
+        }
+        log << (idx == best ? "* " : "  ") << "#" << idx << ": " << result.recall() << ", " << result.precision()
+            << ", " << result.msPerFrame();
+        for (const auto &value : result.values) {
+            log << " " << value.first << "=" << value.second;
+        }
+        log << std::endl;
+    }
+    log << "Best configuration written to " << options.outputPath << ".best.json" << std::endl;
+
+    return results;
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "Common.h"
+#include "FrameIngestion.h"
+#include "TiledLocalizer.h"
+#include "VideoEvaluation.h"
+
+namespace Batch {
+
+/**
+ * values of one pipeline setting that are tried by a sweep
+ */
+struct SweepParameter {
+    // path of the setting in a config file, e.g. BEESBOOKPIPELINE.LOCALIZER.BINARY_THRESHOLD
+    std::string path;
+    // stage whose settings contain the parameter, preprocessor settings belong to the localizer
+    BeesBookCommon::Stage stage;
+    std::vector<std::string> values;
+};
+
+/**
+ * read the parameter ranges of a sweep from a JSON file. Each setting is given either
+ * as a range or as a list of values:
+ *
+ * {
+ *     "BEESBOOKPIPELINE.LOCALIZER.BINARY_THRESHOLD": { "min": 20, "max": 40, "step": 5 },
+ *     "BEESBOOKPIPELINE.ELLIPSEFITTER.CANNY_MEAN_MIN": [ 8, 12, 16 ]
+ * }
+ */
+std::vector<SweepParameter> loadSweepParameters(std::string const &path);
+
+struct SweepResult {
+    // path and value of every sweep parameter, the other settings are taken from the base config
+    std::vector<std::pair<std::string, std::string>> values;
+    EvaluationSummary summary;
+    // sum of the processing times of the stages of this configuration
+    double processingMs = 0.;
+    bool paretoOptimal = false;
+
+    // objectives of the sweep, detection results are those of the gridfitter (the last stage
+    // that can produce false positives)
+    double recall() const { return summary.gridfitter.recall(); }
+    double precision() const { return summary.gridfitter.precision(); }
+    double msPerFrame() const;
+};
+
+struct SweepOptions {
+    // base config, settings that are not swept keep their values
+    std::string configPath;
+    std::string sweepPath;
+    std::string inputPath;
+    std::string groundTruthPath;
+    // results are written to <outputPath>.json and <outputPath>.csv, the best configuration
+    // to <outputPath>.best.json
+    std::string outputPath;
+    FrameFormat inputFormat = FrameFormat::Auto;
+    // evaluate only the first n annotated frames
+    boost::optional<size_t> maxFrames;
+    // configurations evaluated in parallel (0: number of hardware threads)
+    size_t numInstances = 0;
+    size_t queueCapacity = 4;
+    boost::optional<TilingOptions> tiling;
+    size_t logInterval = 100;
+};
+
+/**
+ * mark the configurations that are not dominated by any other one regarding recall,
+ * precision and runtime
+ */
+void markParetoFront(std::vector<SweepResult> &results);
+
+/**
+ * evaluate all combinations of the sweep parameters on the annotated frames.
+ *
+ * Configurations that only differ in the settings of later stages share the outputs of
+ * the earlier stages: the localizer runs once per frame and localizer configuration, the
+ * ellipsefitter once per ellipsefitter configuration on that output, and so on. Each
+ * frame is evaluated for one localizer configuration at a time on options.numInstances
+ * threads.
+ *
+ * @param log progress messages and the pareto front are written to this stream
+ * @return results of all configurations
+ */
+std::vector<SweepResult> runSweep(SweepOptions const &options, std::ostream &log);
+
+}
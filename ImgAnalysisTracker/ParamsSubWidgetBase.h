@@ -6,7 +6,7 @@
 #include <QLineEdit>
 #include <QSpinBox>
 
-#include "Common.h"
+#include "BioTrackerSettings.h"
 #include "biotracker/settings/Settings.h"
 #include "biotracker/widgets/SpinBoxWithSlider.h"
 
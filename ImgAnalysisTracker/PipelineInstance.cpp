@@ -0,0 +1,83 @@
+#include "PipelineInstance.h"
+
+using namespace BeesBookCommon;
+
+PipelineInstance::PipelineInstance(const size_t numThreads)
+    : _tagStages(numThreads) {
+}
+
+PipelineInstance::PipelineInstance(const pipeline_settings_t &settings, const size_t numThreads,
+                                   const boost::optional<TilingOptions> &tiling)
+    : _tagStages(numThreads) {
+    if (tiling) {
+        _tiledLocalizer = std::make_unique<TiledLocalizer>(tiling.get());
+    }
+    loadSettings(settings);
+}
+
+void PipelineInstance::loadSettings(const pipeline_settings_t &settings) {
+    loadSettings(settings.preprocessor);
+    loadSettings(settings.localizer);
+    _tagStages.loadSettings(settings.ellipsefitter);
+    _tagStages.loadSettings(settings.gridfitter);
+}
+
+void PipelineInstance::loadSettings(const pipeline::settings::preprocessor_settings_t &settings) {
+    _preprocessor.loadSettings(settings);
+    if (_tiledLocalizer) {
+        _tiledLocalizer->loadSettings(settings);
+    }
+}
+
+void PipelineInstance::loadSettings(const pipeline::settings::localizer_settings_t &settings) {
+    _localizer.loadSettings(settings);
+    if (_tiledLocalizer) {
+        _tiledLocalizer->loadSettings(settings);
+    }
+}
+
+taglist_t PipelineInstance::localize(const cv::Mat &frameGray) {
+    if (_tiledLocalizer) {
+        return _tiledLocalizer->process(frameGray);
+    }
+    return _localizer.process(_preprocessor.process(frameGray));
+}
+
+taglist_t PipelineInstance::process(const cv::Mat &frameGray, const Stage lastStage,
+                                   const stage_observer_t &observer) {
+    if (lastStage < Stage::Localizer) {
+        return taglist_t();
+    }
+
+    taglist_t taglist = localize(frameGray);
+    if (observer) {
+        observer(Stage::Localizer, taglist);
+    }
+
+    return resume(std::move(taglist), Stage::Localizer, lastStage, observer);
+}
+
+taglist_t PipelineInstance::resume(taglist_t &&taglist, const Stage completedStage, const Stage lastStage,
+                                   const stage_observer_t &observer) {
+    const auto runStage = [&](Stage stage, std::function<taglist_t(taglist_t &&)> const & function) {
+        if (completedStage >= stage || lastStage < stage) {
+            return;
+        }
+        taglist = function(std::move(taglist));
+        if (observer) {
+            observer(stage, taglist);
+        }
+    };
+
+    runStage(Stage::EllipseFitter, [this](taglist_t && tags) {
+        return _tagStages.processEllipseFitter(std::move(tags));
+    });
+    runStage(Stage::GridFitter, [this](taglist_t && tags) {
+        return _tagStages.processGridFitter(std::move(tags));
+    });
+    runStage(Stage::Decoder, [this](taglist_t && tags) {
+        return _tagStages.processDecoder(std::move(tags));
+    });
+
+    return std::move(taglist);
+}
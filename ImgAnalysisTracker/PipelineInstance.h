@@ -0,0 +1,81 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include <boost/optional.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include <pipeline/Preprocessor.h>
+#include <pipeline/Localizer.h>
+
+#include "Common.h"
+#include "TagStageExecutor.h"
+#include "TiledLocalizer.h"
+
+/**
+ * Qt-free bundle of all pipeline stages, processing one grayscale frame at a time.
+ *
+ * The stage objects keep internal state (e.g. the localizer blob and threshold images),
+ * therefore an instance must not be shared between threads. The per-tag stages
+ * may use additional threads internally, see TagStageExecutor.
+ *
+ * With tiling enabled, preprocessor and localizer run on the tiles of the frame in
+ * parallel on TilingOptions::numThreads threads, see TiledLocalizer.
+ */
+class PipelineInstance {
+  public:
+    /**
+     * @param numThreads number of threads used by the per-tag stages, 0 selects the number of hardware threads
+     */
+    explicit PipelineInstance(size_t numThreads = 1);
+    explicit PipelineInstance(BeesBookCommon::pipeline_settings_t const &settings, size_t numThreads = 1,
+                              boost::optional<TilingOptions> const &tiling = boost::none);
+
+    void loadSettings(BeesBookCommon::pipeline_settings_t const &settings);
+    // preprocessor and localizer, including the tiled ones
+    void loadSettings(pipeline::settings::preprocessor_settings_t const &settings);
+    void loadSettings(pipeline::settings::localizer_settings_t const &settings);
+
+    // called with the output of every executed stage, e.g. to write checkpoints
+    typedef std::function<void(BeesBookCommon::Stage, BeesBookCommon::taglist_t const &)> stage_observer_t;
+
+    /**
+     * run all stages up to and including lastStage on the given frame
+     *
+     * @param frameGray 8 bit grayscale frame
+     * @param lastStage last stage that is executed
+     * @return tags found by the pipeline
+     */
+    BeesBookCommon::taglist_t process(cv::Mat const &frameGray,
+                                      BeesBookCommon::Stage lastStage = BeesBookCommon::Stage::Decoder,
+                                      stage_observer_t const &observer = stage_observer_t());
+
+    /**
+     * run the stages after completedStage up to and including lastStage on the output
+     * of completedStage, e.g. loaded from a checkpoint
+     *
+     * @param taglist output of completedStage, including the sub images of the tags
+     */
+    BeesBookCommon::taglist_t resume(BeesBookCommon::taglist_t &&taglist, BeesBookCommon::Stage completedStage,
+                                     BeesBookCommon::Stage lastStage = BeesBookCommon::Stage::Decoder,
+                                     stage_observer_t const &observer = stage_observer_t());
+
+    /**
+     * run preprocessor and localizer (tiled, if enabled) on the given frame
+     */
+    BeesBookCommon::taglist_t localize(cv::Mat const &frameGray);
+
+    bool isTiled() const { return static_cast<bool>(_tiledLocalizer); }
+
+    pipeline::Preprocessor &getPreprocessor() { return _preprocessor; }
+    pipeline::Localizer    &getLocalizer()    { return _localizer; }
+    TagStageExecutor       &getTagStages()    { return _tagStages; }
+
+  private:
+    pipeline::Preprocessor _preprocessor;
+    pipeline::Localizer    _localizer;
+    TagStageExecutor       _tagStages;
+    std::unique_ptr<TiledLocalizer> _tiledLocalizer;
+};
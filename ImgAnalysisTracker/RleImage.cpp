@@ -0,0 +1,100 @@
+#include "RleImage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+RleImage::RleImage(const cv::Mat &image)
+    : _size(image.size()) {
+    if (image.type() != CV_8UC1) {
+        throw std::invalid_argument("only 8 bit single channel images can be run-length encoded");
+    }
+    if (image.empty()) {
+        return;
+    }
+
+    uint8_t value = image.ptr<uint8_t>(0)[0];
+    size_t length = 0;
+    for (int row = 0; row < image.rows; ++row) {
+        const uint8_t *pixel  = image.ptr<uint8_t>(row);
+        const uint8_t *rowEnd = pixel + image.cols;
+
+        while (pixel < rowEnd) {
+            // skip the rest of the current run at once
+            const uint8_t *runEnd = std::find_if(pixel, rowEnd, [value](uint8_t other) {
+                return other != value;
+            });
+            length += static_cast<size_t>(runEnd - pixel);
+            pixel = runEnd;
+
+            if (pixel < rowEnd) {
+                appendRun(value, length);
+                value  = *pixel;
+                length = 0;
+            }
+        }
+    }
+    appendRun(value, length);
+
+    _runs.shrink_to_fit();
+}
+
+void RleImage::appendRun(const uint8_t value, const size_t length) {
+    _runs.push_back(value);
+
+    size_t remaining = length - 1;
+    while (remaining >= 0x80) {
+        _runs.push_back(static_cast<uint8_t>(remaining | 0x80));
+        remaining >>= 7;
+    }
+    _runs.push_back(static_cast<uint8_t>(remaining));
+
+    ++_numRuns;
+}
+
+cv::Mat RleImage::decode() const {
+    cv::Mat image;
+    decode(image);
+    return image;
+}
+
+void RleImage::decode(cv::Mat &image) const {
+    image.create(_size, CV_8UC1);
+    if (empty()) {
+        return;
+    }
+
+    int row = 0;
+    uint8_t *pixel  = image.ptr<uint8_t>(0);
+    uint8_t *rowEnd = pixel + image.cols;
+
+    size_t position = 0;
+    while (position < _runs.size()) {
+        const uint8_t value = _runs[position++];
+
+        size_t length = 0;
+        for (int shift = 0; position < _runs.size(); shift += 7) {
+            const uint8_t byte = _runs[position++];
+            length |= static_cast<size_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        ++length;
+
+        // a run may continue in the following rows
+        while (length) {
+            const size_t count = std::min(length, static_cast<size_t>(rowEnd - pixel));
+            std::memset(pixel, value, count);
+            pixel  += count;
+            length -= count;
+
+            if (pixel == rowEnd && ++row < image.rows) {
+                pixel  = image.ptr<uint8_t>(row);
+                rowEnd = pixel + image.cols;
+            } else if (pixel == rowEnd) {
+                return;
+            }
+        }
+    }
+}
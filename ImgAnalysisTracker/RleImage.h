@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * run-length encoded 8 bit single channel image, for masks that are mostly empty
+ * (e.g. the threshold and blob images of the localizer).
+ *
+ * The pixels are encoded in row-major order, runs continue across rows. Every run is
+ * stored as its pixel value followed by its length - 1 as LEB128 varint, i.e. a run of
+ * up to 128 pixels takes two bytes. Any 8 bit image can be encoded losslessly, images
+ * with few distinct values in large areas are compressed best.
+ *
+ * Immutable once encoded, copies are cheap to share between threads via std::shared_ptr.
+ */
+class RleImage {
+  public:
+    RleImage() = default;
+
+    /**
+     * @param image CV_8UC1 image
+     * @throw std::invalid_argument if the image has a different type
+     */
+    explicit RleImage(cv::Mat const &image);
+
+    cv::Mat decode() const;
+
+    /**
+     * decode into the given image, which is only reallocated if its size or type differ
+     */
+    void decode(cv::Mat &image) const;
+
+    cv::Size size() const { return _size; }
+    bool empty() const { return _size.area() == 0; }
+    size_t getNumRuns() const { return _numRuns; }
+
+    // of the encoded runs, in bytes
+    size_t getEncodedSize() const { return _runs.size(); }
+
+  private:
+    cv::Size _size;
+    size_t _numRuns = 0;
+    std::vector<uint8_t> _runs;
+
+    void appendRun(uint8_t value, size_t length);
+};
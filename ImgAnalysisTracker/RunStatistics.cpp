@@ -0,0 +1,117 @@
+#include "RunStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+void RunningMoments::add(const double value) {
+    ++count;
+    const double delta = value - mean;
+    mean += delta / static_cast<double>(count);
+    m2   += delta * (value - mean);
+}
+
+void RunningMoments::remove(const double value) {
+    if (count <= 1) {
+        *this = RunningMoments();
+        return;
+    }
+
+    // inverse of add()
+    const double delta = value - mean;
+    --count;
+    mean -= delta / static_cast<double>(count);
+    m2   -= delta * (value - mean);
+}
+
+double RunningMoments::variance() const {
+    return count > 1 ? m2 / static_cast<double>(count - 1) : 0.;
+}
+
+double RunningMoments::stddev() const {
+    return std::sqrt(variance());
+}
+
+void RunStatistics::add(const Batch::FrameEvaluation &frame) {
+    const auto it = std::find_if(_recentFrames.begin(), _recentFrames.end(),
+    [&frame](Batch::FrameEvaluation const & recent) {
+        return recent.frameNumber == frame.frameNumber;
+    });
+    if (it != _recentFrames.end()) {
+        update(*it, false);
+        _recentFrames.erase(it);
+    } else if (_recentFrames.size() >= REPLACE_WINDOW) {
+        _recentFrames.pop_front();
+    }
+
+    _recentFrames.push_back(frame);
+    update(frame, true);
+}
+
+void RunStatistics::reset() {
+    _state = State();
+    _recentFrames.clear();
+}
+
+void RunStatistics::update(const Batch::FrameEvaluation &frame, const bool add) {
+    if (add) {
+        _state.summary.add(frame);
+    } else {
+        _state.summary.remove(frame);
+    }
+
+    const auto updateMoments = [add](RunningMoments & moments, double value) {
+        if (add) {
+            moments.add(value);
+        } else {
+            moments.remove(value);
+        }
+    };
+
+    // frames without ground truth or results would distort the per-frame statistics
+    if (frame.gridfitter.numGroundTruth) {
+        updateMoments(_state.recall, frame.gridfitter.recall());
+    }
+    if (frame.gridfitter.numTruePositives + frame.gridfitter.numFalsePositives) {
+        updateMoments(_state.precision, frame.gridfitter.precision());
+    }
+    if (frame.decoder.numResults) {
+        updateMoments(_state.matchRate, static_cast<double>(frame.decoder.numMatches) /
+                      static_cast<double>(frame.decoder.numResults));
+    }
+}
+
+std::string RunStatistics::format() const {
+    const Batch::EvaluationSummary &summary = _state.summary;
+    const Batch::DecoderCounts &decoder     = summary.decoder;
+
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    os << "Ground truth statistics of " << summary.numFrames << " frames" << std::endl;
+    for (const auto &stage : {
+                std::make_pair("Localizer", summary.localizer),
+                std::make_pair("EllipseFitter", summary.ellipsefitter),
+                std::make_pair("GridFitter", summary.gridfitter)
+            }) {
+        os << stage.first << ": precision " << stage.second.precision() << ", recall " << stage.second.recall()
+           << " (tp " << stage.second.numTruePositives << ", fp " << stage.second.numFalsePositives
+           << ", fn " << stage.second.numFalseNegatives << ")" << std::endl;
+    }
+    os << "Per frame: recall " << _state.recall.mean << " +- " << _state.recall.stddev()
+       << ", precision " << _state.precision.mean << " +- " << _state.precision.stddev()
+       << ", match rate " << _state.matchRate.mean << " +- " << _state.matchRate.stddev() << std::endl;
+    os << "Decoder: " << decoder.numMatches << " matches, " << decoder.numPartialMatches << " partial, "
+       << decoder.numMismatches << " mismatches, average hamming distance " << decoder.averageHamming() << std::endl;
+
+    os << "Hamming distances:";
+    for (size_t distance = 0; distance < decoder.hammingHistogram.size(); ++distance) {
+        os << " " << decoder.hammingHistogram[distance];
+    }
+    os << std::endl << "Bit error rates:";
+    for (size_t bit = 0; bit < decoder.bitErrors.size(); ++bit) {
+        os << " " << decoder.bitErrorRate(bit);
+    }
+
+    return os.str();
+}
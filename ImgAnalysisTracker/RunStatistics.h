@@ -0,0 +1,75 @@
+#pragma once
+
+#include <deque>
+#include <string>
+
+#include "VideoEvaluation.h"
+
+/**
+ * mean and variance of a series of values (Welford's algorithm)
+ */
+struct RunningMoments {
+    size_t count = 0;
+    double mean  = 0.;
+    // sum of the squared differences from the mean
+    double m2    = 0.;
+
+    void add(double value);
+    // the value has to have been added before
+    void remove(double value);
+    double variance() const;
+    double stddev() const;
+};
+
+/**
+ * ground truth statistics of all frames of a tracking run.
+ *
+ * Besides the summed counts of all stages (including the hamming distance histogram and
+ * the bit error counts of the decoder), the mean and standard deviation of the per-frame
+ * recall, precision and decoder match rate are kept, which show how stable the results
+ * are over the run. The memory use is constant: only the counts of the last REPLACE_WINDOW
+ * added frames are kept, so a frame that is tracked again (e.g. after seeking back a little)
+ * replaces its earlier contribution. A frame that is tracked again after more than
+ * REPLACE_WINDOW other frames is counted twice.
+ *
+ * Not thread safe.
+ */
+class RunStatistics {
+  public:
+    // number of most recently added frames that are replaced when they are added again
+    static const size_t REPLACE_WINDOW = 512;
+
+    /**
+     * add the results of a frame whose stages have all been evaluated. If the frame is one
+     * of the last REPLACE_WINDOW frames added, its previous results are replaced.
+     */
+    void add(Batch::FrameEvaluation const &frame);
+    void reset();
+
+    size_t getNumFrames() const { return _state.summary.numFrames; }
+    Batch::EvaluationSummary const &getSummary() const { return _state.summary; }
+    // per-frame results of the gridfitter and decoder
+    RunningMoments const &getRecall() const { return _state.recall; }
+    RunningMoments const &getPrecision() const { return _state.precision; }
+    RunningMoments const &getMatchRate() const { return _state.matchRate; }
+
+    /**
+     * @return multi line summary
+     */
+    std::string format() const;
+
+  private:
+    struct State {
+        Batch::EvaluationSummary summary;
+        RunningMoments recall;
+        RunningMoments precision;
+        RunningMoments matchRate;
+    };
+
+    State _state;
+    // counts of the last REPLACE_WINDOW added frames, oldest first
+    std::deque<Batch::FrameEvaluation> _recentFrames;
+
+    // add or remove the contribution of the frame
+    void update(Batch::FrameEvaluation const &frame, bool add);
+};
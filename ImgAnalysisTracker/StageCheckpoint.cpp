@@ -0,0 +1,65 @@
+#include "StageCheckpoint.h"
+
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include <pipeline/datastructure/Tag.h>
+
+using namespace BeesBookCommon;
+
+namespace Batch {
+
+std::string getCheckpointPath(const std::string &directory, const Stage stage) {
+    std::string name;
+    switch (stage) {
+    case Stage::Localizer:
+        name = "localizer";
+        break;
+    case Stage::EllipseFitter:
+        name = "ellipsefitter";
+        break;
+    case Stage::GridFitter:
+        name = "gridfitter";
+        break;
+    case Stage::Decoder:
+        name = "decoder";
+        break;
+    default:
+        throw std::invalid_argument("the output of this stage can not be checkpointed");
+    }
+
+    return (boost::filesystem::path(directory) / (name + ".bbtags")).string();
+}
+
+CheckpointWriter::CheckpointWriter(const std::string &directory)
+    : _directory(directory) {
+    boost::filesystem::create_directories(directory);
+}
+
+void CheckpointWriter::write(const size_t frameNumber, const Stage stage, const taglist_t &taglist) {
+    std::unique_ptr<BinaryTaglistWriter> &writer = _writers[stage];
+    if (!writer) {
+        writer = std::make_unique<BinaryTaglistWriter>(getCheckpointPath(_directory, stage));
+    }
+    writer->write(frameNumber, taglist);
+}
+
+CheckpointReader::CheckpointReader(const std::string &directory, const Stage stage)
+    : _stage(stage),
+      _reader(getCheckpointPath(directory, stage)) {
+}
+
+taglist_t CheckpointReader::read(const size_t frameNumber, const cv::Mat &frameGray) const {
+    taglist_t taglist = _reader.read(frameNumber);
+
+    // the localizer cuts the sub images out of the original grayscale frame
+    const cv::Rect frame(cv::Point(0, 0), frameGray.size());
+    for (pipeline::Tag &tag : taglist) {
+        tag.setOrigSubImage(frameGray(tag.getRoi() & frame).clone());
+    }
+
+    return taglist;
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "BinaryTaglist.h"
+#include "Common.h"
+
+/**
+ * per-frame output of the pipeline stages, to rerun only the stages after a given one.
+ *
+ * A checkpoint is a directory with one binary taglist file per stage (localizer.bbtags,
+ * ellipsefitter.bbtags, gridfitter.bbtags and decoder.bbtags), see BinaryTaglist. The
+ * sub images of the tags are not stored, they are cut out of the frame again when a
+ * checkpoint is loaded.
+ */
+namespace Batch {
+
+/**
+ * @return binary taglist file of the stage in the checkpoint directory
+ * @throw std::invalid_argument if the output of the stage can not be checkpointed
+ */
+std::string getCheckpointPath(std::string const &directory, BeesBookCommon::Stage stage);
+
+/**
+ * appends the output of the stages to the files of a checkpoint directory. Existing
+ * files are continued, a frame written again replaces its previous output.
+ */
+class CheckpointWriter {
+  public:
+    /**
+     * @param directory created if it does not exist
+     */
+    explicit CheckpointWriter(std::string const &directory);
+
+    void write(size_t frameNumber, BeesBookCommon::Stage stage, BeesBookCommon::taglist_t const &taglist);
+
+    std::string const &getDirectory() const { return _directory; }
+
+  private:
+    std::string _directory;
+    // opened on first use
+    std::map<BeesBookCommon::Stage, std::unique_ptr<BinaryTaglistWriter>> _writers;
+};
+
+/**
+ * random access to the output of one stage in a checkpoint directory
+ */
+class CheckpointReader {
+  public:
+    CheckpointReader(std::string const &directory, BeesBookCommon::Stage stage);
+
+    BeesBookCommon::Stage getStage() const { return _stage; }
+    // sorted
+    std::vector<size_t> getFrameNumbers() const { return _reader.getFrameNumbers(); }
+    bool hasFrame(size_t frameNumber) const { return _reader.hasFrame(frameNumber); }
+
+    /**
+     * @param frameGray grayscale frame the checkpoint was created from, the sub images
+     *                  of the tags are restored from it
+     * @throw std::out_of_range if the frame is not in the checkpoint
+     */
+    BeesBookCommon::taglist_t read(size_t frameNumber, cv::Mat const &frameGray) const;
+
+  private:
+    BeesBookCommon::Stage _stage;
+    BinaryTaglistReader _reader;
+};
+
+}
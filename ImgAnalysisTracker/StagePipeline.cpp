@@ -0,0 +1,203 @@
+#include "StagePipeline.h"
+
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+using namespace BeesBookCommon;
+
+namespace {
+/**
+ * @return share of the threads of the per-tag stage, the executed per-tag stages get
+ *         at least one thread each
+ */
+size_t getStageThreads(const size_t numThreads, const Stage lastStage, const Stage stage) {
+    size_t numStages = 0;
+    size_t stageIdx  = 0;
+    for (const Stage tagStage : { Stage::EllipseFitter, Stage::GridFitter, Stage::Decoder }) {
+        if (tagStage < stage) {
+            ++stageIdx;
+        }
+        if (tagStage <= lastStage) {
+            ++numStages;
+        }
+    }
+    if (stageIdx >= numStages) {
+        // not executed
+        return 1;
+    }
+
+    // the remainder goes to the first stages
+    const size_t total = ThreadPool::resolveNumThreads(numThreads);
+    const size_t share = total / numStages + (stageIdx < total % numStages ? 1 : 0);
+    return std::max<size_t>(share, 1);
+}
+}
+
+StagePipeline::StagePipeline(const pipeline_settings_t &settings, frame_source_t source,
+                             const Stage lastStage, const size_t queueCapacity, const size_t numThreads,
+                             const boost::optional<TilingOptions> &tiling)
+    : _pipeline(settings, getStageThreads(numThreads, lastStage, Stage::EllipseFitter), tiling),
+      _gridfitterStages(getStageThreads(numThreads, lastStage, Stage::GridFitter)),
+      _decoderStages(getStageThreads(numThreads, lastStage, Stage::Decoder)),
+      _source(std::move(source)) {
+    _gridfitterStages.loadSettings(settings.gridfitter);
+
+    const auto addStage = [&](std::string const &name, stage_function_t function) {
+        _stages.push_back({ name, std::move(function), 0, std::chrono::steady_clock::duration::zero() });
+    };
+
+    if (_pipeline.isTiled()) {
+        // the tiles are already processed in parallel, there is no separate preprocessor stage
+        addStage("TiledLocalizer", [this](Job & job) {
+            job.taglist = _pipeline.localize(job.frameGray);
+            job.frameGray.release();
+        });
+    } else {
+        addStage("Preprocessor", [this](Job & job) {
+            job.preprocessed = _pipeline.getPreprocessor().process(job.frameGray);
+            job.frameGray.release();
+        });
+    }
+    if (lastStage >= Stage::Localizer && !_pipeline.isTiled()) {
+        addStage("Localizer", [this](Job & job) {
+            job.taglist = _pipeline.getLocalizer().process(std::move(job.preprocessed));
+            job.preprocessed = pipeline::PreprocessorResult();
+        });
+    }
+    if (lastStage >= Stage::EllipseFitter) {
+        addStage("EllipseFitter", [this](Job & job) {
+            job.taglist = _pipeline.getTagStages().processEllipseFitter(std::move(job.taglist));
+        });
+    }
+    if (lastStage >= Stage::GridFitter) {
+        addStage("GridFitter", [this](Job & job) {
+            job.taglist = _gridfitterStages.processGridFitter(std::move(job.taglist));
+        });
+    }
+    if (lastStage >= Stage::Decoder) {
+        addStage("Decoder", [this](Job & job) {
+            job.taglist = _decoderStages.processDecoder(std::move(job.taglist));
+        });
+    }
+
+    // one input queue per stage plus the output queue
+    for (size_t idx = 0; idx <= _stages.size(); ++idx) {
+        _queues.push_back(std::make_unique<queue_t>(queueCapacity));
+    }
+
+    _threads.emplace_back(&StagePipeline::runSource, this);
+    for (size_t idx = 0; idx < _stages.size(); ++idx) {
+        _threads.emplace_back(&StagePipeline::runStage, this, idx);
+    }
+}
+
+StagePipeline::~StagePipeline() {
+    shutdown();
+}
+
+bool StagePipeline::pop(size_t &frameNumber, taglist_t &taglist) {
+    Job job;
+    if (!_queues.back()->pop(job)) {
+        shutdown();
+
+        const std::lock_guard<std::mutex> lock(_errorMutex);
+        if (_error) {
+            std::rethrow_exception(_error);
+        }
+        return false;
+    }
+
+    frameNumber = job.frameNumber;
+    taglist     = std::move(job.taglist);
+    return true;
+}
+
+std::vector<StagePipeline::StageStatistics> StagePipeline::getStatistics() const {
+    typedef std::chrono::duration<double, std::milli> ms_t;
+
+    std::vector<StageStatistics> statistics;
+
+    const std::lock_guard<std::mutex> lock(_statisticsMutex);
+    for (size_t idx = 0; idx < _stages.size(); ++idx) {
+        const StageWorker &stage = _stages[idx];
+        statistics.push_back({ stage.name, stage.numFrames,
+                               std::chrono::duration_cast<ms_t>(stage.busy).count(),
+                               _queues[idx]->getStatistics() });
+    }
+
+    const QueueStatistics output = _queues.back()->getStatistics();
+    statistics.push_back({ "Output", output.numPushed, 0., output });
+
+    return statistics;
+}
+
+void StagePipeline::runSource() {
+    try {
+        Job job;
+        while (_source(job.frameNumber, job.frameGray)) {
+            if (!_queues.front()->push(std::move(job))) {
+                break;
+            }
+            job = Job();
+        }
+    } catch (...) {
+        setError(std::current_exception());
+    }
+
+    _queues.front()->close();
+}
+
+void StagePipeline::runStage(const size_t stageIdx) {
+    queue_t &input  = *_queues[stageIdx];
+    queue_t &output = *_queues[stageIdx + 1];
+    StageWorker &stage = _stages[stageIdx];
+
+    try {
+        Job job;
+        while (input.pop(job)) {
+            const auto start = std::chrono::steady_clock::now();
+            stage.function(job);
+            const auto end = std::chrono::steady_clock::now();
+
+            {
+                const std::lock_guard<std::mutex> lock(_statisticsMutex);
+                ++stage.numFrames;
+                stage.busy += end - start;
+            }
+
+            if (!output.push(std::move(job))) {
+                break;
+            }
+        }
+    } catch (...) {
+        setError(std::current_exception());
+    }
+
+    output.close();
+}
+
+void StagePipeline::setError(std::exception_ptr error) {
+    {
+        const std::lock_guard<std::mutex> lock(_errorMutex);
+        if (!_error) {
+            _error = error;
+        }
+    }
+
+    // abort all other workers
+    for (const std::unique_ptr<queue_t> &queue : _queues) {
+        queue->close();
+    }
+}
+
+void StagePipeline::shutdown() {
+    for (const std::unique_ptr<queue_t> &queue : _queues) {
+        queue->close();
+    }
+    for (std::thread &thread : _threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
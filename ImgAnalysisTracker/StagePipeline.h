@@ -0,0 +1,105 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "BoundedQueue.h"
+#include "Common.h"
+#include "PipelineInstance.h"
+#include "TagStageExecutor.h"
+
+/**
+ * pipelined execution of the pipeline stages: the frame source and every stage run
+ * on their own thread and are connected by bounded queues. While frame N is in the
+ * gridfitter, frame N+1 can already be preprocessed and localized.
+ *
+ * Each stage object is only ever used by its own worker thread. Because every stage
+ * has exactly one worker and the queues are FIFO, results are popped in frame order.
+ * The per-tag stages each have their own TagStageExecutor, so that they can process
+ * different frames at the same time.
+ */
+class StagePipeline {
+  public:
+    /**
+     * @return false if there are no frames left
+     */
+    typedef std::function<bool(size_t &frameNumber, cv::Mat &frameGray)> frame_source_t;
+
+    struct StageStatistics {
+        std::string name;
+        size_t numFrames;
+        double busyMs;
+        // queue the stage takes its input from
+        QueueStatistics inputQueue;
+    };
+
+    /**
+     * @param numThreads number of threads of the per-tag stages, split between the ellipsefitter,
+     *        gridfitter and decoder (0: number of hardware threads), see TagStageExecutor
+     * @param tiling if set, preprocessor and localizer are combined into one tiled stage
+     */
+    StagePipeline(BeesBookCommon::pipeline_settings_t const &settings, frame_source_t source,
+                  BeesBookCommon::Stage lastStage, size_t queueCapacity, size_t numThreads = 1,
+                  boost::optional<TilingOptions> const &tiling = boost::none);
+    ~StagePipeline();
+
+    StagePipeline(StagePipeline const &) = delete;
+    StagePipeline &operator=(StagePipeline const &) = delete;
+
+    /**
+     * blocks until the result of the next frame is available.
+     * Rethrows exceptions that occurred in one of the workers.
+     *
+     * @return false if all frames have been processed
+     */
+    bool pop(size_t &frameNumber, BeesBookCommon::taglist_t &taglist);
+
+    /**
+     * statistics of all stages, the last entry describes the output queue
+     */
+    std::vector<StageStatistics> getStatistics() const;
+
+  private:
+    struct Job {
+        size_t frameNumber;
+        cv::Mat frameGray;
+        pipeline::PreprocessorResult preprocessed;
+        BeesBookCommon::taglist_t taglist;
+    };
+
+    typedef BoundedQueue<Job> queue_t;
+    typedef std::function<void(Job &)> stage_function_t;
+
+    struct StageWorker {
+        std::string name;
+        stage_function_t function;
+        size_t numFrames;
+        std::chrono::steady_clock::duration busy;
+    };
+
+    // its TagStageExecutor runs the ellipsefitter
+    PipelineInstance _pipeline;
+    TagStageExecutor _gridfitterStages;
+    TagStageExecutor _decoderStages;
+    frame_source_t _source;
+
+    std::vector<StageWorker> _stages;
+    std::vector<std::unique_ptr<queue_t>> _queues;
+    std::vector<std::thread> _threads;
+
+    mutable std::mutex _statisticsMutex;
+    std::mutex _errorMutex;
+    std::exception_ptr _error;
+
+    void runSource();
+    void runStage(size_t stageIdx);
+    void setError(std::exception_ptr error);
+    void shutdown();
+};
@@ -0,0 +1,147 @@
+#include "TagStageExecutor.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <pipeline/datastructure/Tag.h>
+
+using namespace BeesBookCommon;
+
+TagStageExecutor::TagStageExecutor(const size_t numThreads) {
+    setNumThreads(numThreads);
+}
+
+void TagStageExecutor::setNumThreads(const size_t numThreads) {
+    const size_t num = ThreadPool::resolveNumThreads(numThreads);
+    if (_pool && _pool->getNumThreads() == num) {
+        return;
+    }
+
+    _pool = std::make_unique<ThreadPool>(num);
+
+    _ellipsefitters.resize(num);
+    _gridFitters.resize(num);
+    _decoders.resize(num);
+
+    for (size_t idx = 0; idx < num; ++idx) {
+        if (!_ellipsefitters[idx]) {
+            _ellipsefitters[idx] = std::make_unique<pipeline::EllipseFitter>();
+            if (_ellipsefitterSettings) {
+                _ellipsefitters[idx]->loadSettings(_ellipsefitterSettings.get());
+            }
+        }
+        if (!_gridFitters[idx]) {
+            _gridFitters[idx] = std::make_unique<pipeline::GridFitter>();
+            if (_gridfitterSettings) {
+                _gridFitters[idx]->loadSettings(_gridfitterSettings.get());
+            }
+        }
+        if (!_decoders[idx]) {
+            _decoders[idx] = std::make_unique<pipeline::Decoder>();
+        }
+    }
+}
+
+void TagStageExecutor::loadSettings(const pipeline::settings::ellipsefitter_settings_t &settings) {
+    _ellipsefitterSettings = settings;
+    for (const std::unique_ptr<pipeline::EllipseFitter> &ellipsefitter : _ellipsefitters) {
+        ellipsefitter->loadSettings(settings);
+    }
+}
+
+void TagStageExecutor::loadSettings(const pipeline::settings::gridfitter_settings_t &settings) {
+    _gridfitterSettings = settings;
+    for (const std::unique_ptr<pipeline::GridFitter> &gridFitter : _gridFitters) {
+        gridFitter->loadSettings(settings);
+    }
+}
+
+taglist_t TagStageExecutor::processEllipseFitter(taglist_t &&taglist) {
+    return process(std::move(taglist), [this](size_t workerIdx, taglist_t && chunk) {
+        return _ellipsefitters[workerIdx]->process(std::move(chunk));
+    });
+}
+
+taglist_t TagStageExecutor::processGridFitter(taglist_t &&taglist) {
+    return process(std::move(taglist), [this](size_t workerIdx, taglist_t && chunk) {
+        return _gridFitters[workerIdx]->process(std::move(chunk));
+    });
+}
+
+taglist_t TagStageExecutor::processDecoder(taglist_t &&taglist) {
+    return process(std::move(taglist), [this](size_t workerIdx, taglist_t && chunk) {
+        return _decoders[workerIdx]->process(std::move(chunk));
+    });
+}
+
+cv::Mat TagStageExecutor::computeCannyEdgeMap(const taglist_t &taglist, const cv::Size &frameSize) {
+    std::vector<cv::Mat> edgeMaps(taglist.size());
+    _pool->parallelFor(taglist.size(), [&](size_t tagIdx, size_t workerIdx) {
+        edgeMaps[tagIdx] = _ellipsefitters[workerIdx]->computeCannyEdgeMap(taglist[tagIdx].getOrigSubImage());
+    });
+
+    // ROIs may overlap, so the edges are combined on the calling thread
+    cv::Mat canvas = cv::Mat::zeros(frameSize, CV_8UC1);
+    const cv::Rect frame(cv::Point(0, 0), frameSize);
+    for (size_t tagIdx = 0; tagIdx < taglist.size(); ++tagIdx) {
+        const cv::Rect placement(taglist[tagIdx].getRoi().tl(), edgeMaps[tagIdx].size());
+        const cv::Rect roi = placement & frame;
+        if (roi.area() == 0) {
+            continue;
+        }
+
+        const cv::Mat edges = edgeMaps[tagIdx](cv::Rect(roi.tl() - placement.tl(), roi.size()));
+        cv::Mat target = canvas(roi);
+        cv::bitwise_or(target, edges, target);
+    }
+
+    return canvas;
+}
+
+taglist_t TagStageExecutor::process(taglist_t &&taglist, const chunk_function_t &function) {
+    const size_t numThreads = _pool->getNumThreads();
+
+    // serial path, uses the same stage object as the caller thread of the pool
+    if (numThreads == 1 || taglist.size() < 2) {
+        return function(numThreads - 1, std::move(taglist));
+    }
+
+    const size_t numChunks = std::min(taglist.size(), numThreads * CHUNKS_PER_THREAD);
+
+    std::vector<taglist_t> chunks(numChunks);
+    for (size_t chunkIdx = 0; chunkIdx < numChunks; ++chunkIdx) {
+        const size_t begin = (taglist.size() * chunkIdx) / numChunks;
+        const size_t end   = (taglist.size() * (chunkIdx + 1)) / numChunks;
+
+        chunks[chunkIdx].assign(std::make_move_iterator(taglist.begin() + begin),
+                                std::make_move_iterator(taglist.begin() + end));
+    }
+
+    _pool->parallelFor(numChunks, [&](size_t chunkIdx, size_t workerIdx) {
+        chunks[chunkIdx] = function(workerIdx, std::move(chunks[chunkIdx]));
+    });
+
+    size_t numResults = 0;
+    for (taglist_t const &chunk : chunks) {
+        numResults += chunk.size();
+    }
+
+    // the stages usually modify the tags in place. In that case the results are moved
+    // back into the original taglist, so the storage of the tags stays the same as in
+    // the serial path (e.g. for references kept by the ground truth evaluation)
+    if (numResults == taglist.size()) {
+        auto it = taglist.begin();
+        for (taglist_t &chunk : chunks) {
+            it = std::move(chunk.begin(), chunk.end(), it);
+        }
+        return std::move(taglist);
+    }
+
+    // concatenate in chunk order to preserve the order of the serial path
+    taglist_t result;
+    result.reserve(numResults);
+    for (taglist_t &chunk : chunks) {
+        result.insert(result.end(), std::make_move_iterator(chunk.begin()), std::make_move_iterator(chunk.end()));
+    }
+    return result;
+}
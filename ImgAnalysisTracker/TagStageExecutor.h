@@ -0,0 +1,76 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <pipeline/EllipseFitter.h>
+#include <pipeline/GridFitter.h>
+#include <pipeline/Decoder.h>
+
+#include "Common.h"
+#include "ThreadPool.h"
+
+/**
+ * runs the per-tag stages (ellipsefitter, gridfitter, decoder) data parallel.
+ *
+ * The taglist is split into chunks which are processed by a work-stealing thread pool.
+ * Every worker uses its own copy of the stage objects and the chunk results are
+ * concatenated in chunk order, so the output is identical to processing the whole
+ * taglist with a single stage object.
+ */
+class TagStageExecutor {
+  public:
+    /**
+     * @param numThreads number of threads, 0 selects the number of hardware threads
+     */
+    explicit TagStageExecutor(size_t numThreads = 1);
+
+    void setNumThreads(size_t numThreads);
+    size_t getNumThreads() const { return _pool->getNumThreads(); }
+
+    void loadSettings(pipeline::settings::ellipsefitter_settings_t const &settings);
+    void loadSettings(pipeline::settings::gridfitter_settings_t const &settings);
+
+    // settings of the last loadSettings() call, if any
+    boost::optional<pipeline::settings::ellipsefitter_settings_t> const &getEllipseFitterSettings() const {
+        return _ellipsefitterSettings;
+    }
+
+    BeesBookCommon::taglist_t processEllipseFitter(BeesBookCommon::taglist_t &&taglist);
+    BeesBookCommon::taglist_t processGridFitter(BeesBookCommon::taglist_t &&taglist);
+    BeesBookCommon::taglist_t processDecoder(BeesBookCommon::taglist_t &&taglist);
+
+    /**
+     * canny edge map of the tag ROIs composited onto a black image of the frame size.
+     * The edges of every ROI are computed in parallel from its sub image, i.e. with the
+     * same adaptive thresholds the ellipsefitter uses for that tag.
+     */
+    cv::Mat computeCannyEdgeMap(BeesBookCommon::taglist_t const &taglist, cv::Size const &frameSize);
+
+    /**
+     * stage objects of the calling thread for work that is not split by tags (e.g. visualizations)
+     */
+    pipeline::EllipseFitter &getEllipseFitter() { return *_ellipsefitters.back(); }
+    pipeline::GridFitter    &getGridFitter()    { return *_gridFitters.back(); }
+    pipeline::Decoder       &getDecoder()       { return *_decoders.back(); }
+
+  private:
+    typedef std::function<BeesBookCommon::taglist_t(size_t workerIdx, BeesBookCommon::taglist_t &&)> chunk_function_t;
+
+    // chunks per thread, more chunks allow better load balancing by stealing
+    static const size_t CHUNKS_PER_THREAD = 4;
+
+    std::unique_ptr<ThreadPool> _pool;
+
+    std::vector<std::unique_ptr<pipeline::EllipseFitter>> _ellipsefitters;
+    std::vector<std::unique_ptr<pipeline::GridFitter>>    _gridFitters;
+    std::vector<std::unique_ptr<pipeline::Decoder>>       _decoders;
+
+    boost::optional<pipeline::settings::ellipsefitter_settings_t> _ellipsefitterSettings;
+    boost::optional<pipeline::settings::gridfitter_settings_t>    _gridfitterSettings;
+
+    BeesBookCommon::taglist_t process(BeesBookCommon::taglist_t &&taglist, chunk_function_t const &function);
+};
@@ -0,0 +1,154 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+size_t ThreadPool::resolveNumThreads(const size_t numThreads) {
+    if (numThreads) {
+        return numThreads;
+    }
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+ThreadPool::ThreadPool(const size_t numThreads)
+    : _task(nullptr),
+      _remaining(0),
+      _generation(0),
+      _stop(false) {
+    const size_t num = resolveNumThreads(numThreads);
+
+    for (size_t idx = 0; idx < num; ++idx) {
+        _queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    // the last worker index belongs to the thread calling parallelFor
+    for (size_t idx = 0; idx + 1 < num; ++idx) {
+        _threads.emplace_back(&ThreadPool::workerLoop, this, idx);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+
+    for (std::thread &thread : _threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallelFor(const size_t numTasks, const task_t &task) {
+    if (!numTasks) {
+        return;
+    }
+
+    const std::lock_guard<std::mutex> callLock(_callMutex);
+
+    const size_t numWorkers = _queues.size();
+
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _task      = &task;
+        _remaining = numTasks;
+        _error     = nullptr;
+
+        // contiguous blocks keep neighbouring tasks on the same worker
+        for (size_t workerIdx = 0; workerIdx < numWorkers; ++workerIdx) {
+            const size_t begin = (numTasks * workerIdx) / numWorkers;
+            const size_t end   = (numTasks * (workerIdx + 1)) / numWorkers;
+
+            WorkQueue &queue = *_queues[workerIdx];
+            const std::lock_guard<std::mutex> queueLock(queue.mutex);
+            for (size_t taskIdx = begin; taskIdx < end; ++taskIdx) {
+                queue.tasks.push_back(taskIdx);
+            }
+        }
+
+        ++_generation;
+    }
+    _wake.notify_all();
+
+    const size_t callerIdx = numWorkers - 1;
+    while (runTask(callerIdx)) {}
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [&]() { return _remaining == 0; });
+    _task = nullptr;
+
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+}
+
+void ThreadPool::workerLoop(const size_t workerIdx) {
+    size_t generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&]() { return _stop || _generation != generation; });
+            if (_stop) {
+                return;
+            }
+            generation = _generation;
+        }
+
+        while (runTask(workerIdx)) {}
+    }
+}
+
+bool ThreadPool::runTask(const size_t workerIdx) {
+    size_t taskIdx;
+    if (!takeTask(workerIdx, taskIdx)) {
+        return false;
+    }
+
+    try {
+        (*_task)(taskIdx, workerIdx);
+    } catch (...) {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        if (!_error) {
+            _error = std::current_exception();
+        }
+    }
+
+    bool finished;
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        finished = (--_remaining == 0);
+    }
+    if (finished) {
+        _done.notify_all();
+    }
+
+    return true;
+}
+
+bool ThreadPool::takeTask(const size_t workerIdx, size_t &taskIdx) {
+    const size_t numWorkers = _queues.size();
+
+    // own queue first
+    {
+        WorkQueue &queue = *_queues[workerIdx];
+        const std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            taskIdx = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+
+    // steal from the back of the other queues
+    for (size_t offset = 1; offset < numWorkers; ++offset) {
+        WorkQueue &queue = *_queues[(workerIdx + offset) % numWorkers];
+        const std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            taskIdx = queue.tasks.back();
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * fixed size work-stealing thread pool for data parallel loops.
+ *
+ * parallelFor() hands every worker a contiguous block of task indices. Workers
+ * process their own block front to back and, once it is exhausted, steal from
+ * the back of the other blocks. The calling thread takes part as the last worker,
+ * so a pool with a single thread runs everything on the caller.
+ */
+class ThreadPool {
+  public:
+    /**
+     * @param taskIdx index of the task in [0, numTasks)
+     * @param workerIdx index of the executing worker in [0, getNumThreads())
+     */
+    typedef std::function<void(size_t taskIdx, size_t workerIdx)> task_t;
+
+    /**
+     * @param numThreads total number of threads including the caller,
+     *        0 selects the number of hardware threads
+     */
+    explicit ThreadPool(size_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    size_t getNumThreads() const { return _queues.size(); }
+
+    /**
+     * run task for every index in [0, numTasks) and block until all tasks are finished.
+     * The first exception thrown by a task is rethrown after all tasks are finished.
+     */
+    void parallelFor(size_t numTasks, task_t const &task);
+
+    static size_t resolveNumThreads(size_t numThreads);
+
+  private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> _queues;
+    std::vector<std::thread> _threads;
+
+    // only one parallelFor at a time
+    std::mutex _callMutex;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    task_t const *_task;
+    size_t _remaining;
+    size_t _generation;
+    bool _stop;
+    std::exception_ptr _error;
+
+    void workerLoop(size_t workerIdx);
+    bool runTask(size_t workerIdx);
+    bool takeTask(size_t workerIdx, size_t &taskIdx);
+};
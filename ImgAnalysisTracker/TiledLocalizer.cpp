@@ -0,0 +1,129 @@
+#include "TiledLocalizer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <pipeline/datastructure/Tag.h>
+
+using namespace BeesBookCommon;
+
+namespace {
+cv::Point center(cv::Rect const &rect) {
+    return cv::Point(rect.x + rect.width / 2, rect.y + rect.height / 2);
+}
+
+double intersectionOverUnion(cv::Rect const &lhs, cv::Rect const &rhs) {
+    const double intersection = (lhs & rhs).area();
+    const double united = lhs.area() + rhs.area() - intersection;
+    return united > 0. ? intersection / united : 0.;
+}
+}
+
+constexpr double TiledLocalizer::DUPLICATE_MIN_IOU;
+
+TiledLocalizer::TiledLocalizer(const TilingOptions &options)
+    : _options(options),
+      _halo(options.halo ? options.halo.get() : 0),
+      _pool(std::make_unique<ThreadPool>(options.numThreads)) {
+    if (_options.tileSize <= 0) {
+        throw std::invalid_argument("tile size has to be positive");
+    }
+
+    for (size_t idx = 0; idx < _pool->getNumThreads(); ++idx) {
+        _preprocessors.push_back(std::make_unique<pipeline::Preprocessor>());
+        _localizers.push_back(std::make_unique<pipeline::Localizer>());
+    }
+}
+
+void TiledLocalizer::loadSettings(const pipeline::settings::preprocessor_settings_t &settings) {
+    for (const std::unique_ptr<pipeline::Preprocessor> &preprocessor : _preprocessors) {
+        preprocessor->loadSettings(settings);
+    }
+}
+
+void TiledLocalizer::loadSettings(const pipeline::settings::localizer_settings_t &settings) {
+    for (const std::unique_ptr<pipeline::Localizer> &localizer : _localizers) {
+        localizer->loadSettings(settings);
+    }
+
+    // a tag whose center lies in a tile core has to be completely visible in the tile
+    const int tagSize = pipeline::settings::localizer_settings_t(settings).get_tag_size();
+    _halo = std::max(_options.halo ? _options.halo.get() : 0, tagSize);
+}
+
+size_t TiledLocalizer::getNumTiles(const cv::Size &frameSize) const {
+    return getTiles(frameSize).size();
+}
+
+std::vector<TiledLocalizer::Tile> TiledLocalizer::getTiles(const cv::Size &frameSize) const {
+    const cv::Rect frame(cv::Point(0, 0), frameSize);
+
+    std::vector<Tile> tiles;
+    for (int y = 0; y < frameSize.height; y += _options.tileSize) {
+        for (int x = 0; x < frameSize.width; x += _options.tileSize) {
+            const cv::Rect core = cv::Rect(x, y, _options.tileSize, _options.tileSize) & frame;
+            const cv::Rect region = cv::Rect(core.x - _halo, core.y - _halo,
+                                             core.width + 2 * _halo, core.height + 2 * _halo) & frame;
+            tiles.push_back({ core, region });
+        }
+    }
+    return tiles;
+}
+
+taglist_t TiledLocalizer::process(const cv::Mat &frameGray) {
+    const std::vector<Tile> tiles = getTiles(frameGray.size());
+    std::vector<taglist_t> tileTaglists(tiles.size());
+
+    _pool->parallelFor(tiles.size(), [&](size_t tileIdx, size_t workerIdx) {
+        const Tile &tile = tiles[tileIdx];
+
+        taglist_t taglist = _localizers[workerIdx]->process(
+                                _preprocessors[workerIdx]->process(frameGray(tile.region)));
+
+        // keep the tags owned by this tile and move them to frame coordinates
+        const cv::Point offset = tile.region.tl();
+        for (pipeline::Tag &tag : taglist) {
+            const cv::Rect roi = tag.getRoi() + offset;
+            if (!tile.core.contains(center(roi))) {
+                continue;
+            }
+            tag.setRoi(roi);
+            tag.setBox(tag.getBox() + offset);
+            tileTaglists[tileIdx].push_back(std::move(tag));
+        }
+    });
+
+    return merge(tiles, std::move(tileTaglists));
+}
+
+taglist_t TiledLocalizer::merge(const std::vector<Tile> &tiles, std::vector<taglist_t> &&tileTaglists) {
+    // only tags whose ROI reaches out of the core of their tile can be duplicates
+    struct BorderTag {
+        size_t tileIdx;
+        cv::Rect roi;
+    };
+    std::vector<BorderTag> borderTags;
+
+    taglist_t taglist;
+    for (size_t tileIdx = 0; tileIdx < tiles.size(); ++tileIdx) {
+        for (pipeline::Tag &tag : tileTaglists[tileIdx]) {
+            const cv::Rect &roi = tag.getRoi();
+
+            if ((roi & tiles[tileIdx].core) != roi) {
+                const bool duplicate = std::any_of(borderTags.begin(), borderTags.end(),
+                [&](BorderTag const & other) {
+                    return other.tileIdx != tileIdx &&
+                           intersectionOverUnion(other.roi, roi) >= DUPLICATE_MIN_IOU;
+                });
+                if (duplicate) {
+                    continue;
+                }
+                borderTags.push_back({ tileIdx, roi });
+            }
+
+            taglist.push_back(std::move(tag));
+        }
+    }
+
+    return taglist;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include <pipeline/Preprocessor.h>
+#include <pipeline/Localizer.h>
+
+#include "Common.h"
+#include "ThreadPool.h"
+
+struct TilingOptions {
+    // edge length of the tile cores in pixels
+    int tileSize = 2048;
+    // overlap added on each side of a tile core, never smaller than the tag size
+    // of the localizer settings
+    boost::optional<int> halo;
+    // threads processing the tiles, independent of the threads of the per-tag stages.
+    // 0 selects the number of hardware threads
+    size_t numThreads = 0;
+};
+
+/**
+ * runs preprocessor and localizer on the tiles of a large frame in parallel.
+ *
+ * The frame is split into a grid of tile cores. Every tile is processed with a halo
+ * of at least the tag size around its core, so every tag whose center lies in a core
+ * is completely visible in that tile. A tag is only kept by the tile whose core contains
+ * its center. Detections near core borders that still overlap (the localizer may place
+ * the ROI of the same tag slightly differently in two tiles) are merged afterwards.
+ *
+ * The ROIs of the merged taglist are in frame coordinates.
+ */
+class TiledLocalizer {
+  public:
+    explicit TiledLocalizer(TilingOptions const &options);
+
+    void loadSettings(pipeline::settings::preprocessor_settings_t const &settings);
+    void loadSettings(pipeline::settings::localizer_settings_t const &settings);
+
+    BeesBookCommon::taglist_t process(cv::Mat const &frameGray);
+
+    size_t getNumTiles(cv::Size const &frameSize) const;
+
+  private:
+    struct Tile {
+        // region of the frame that owns the tags
+        cv::Rect core;
+        // core plus halo, clipped to the frame
+        cv::Rect region;
+    };
+
+    // minimal intersection over union of two ROIs detected in different tiles to be
+    // considered the same tag
+    static constexpr double DUPLICATE_MIN_IOU = 0.5;
+
+    const TilingOptions _options;
+    int _halo;
+
+    std::unique_ptr<ThreadPool> _pool;
+    std::vector<std::unique_ptr<pipeline::Preprocessor>> _preprocessors;
+    std::vector<std::unique_ptr<pipeline::Localizer>>    _localizers;
+
+    std::vector<Tile> getTiles(cv::Size const &frameSize) const;
+    static BeesBookCommon::taglist_t merge(std::vector<Tile> const &tiles,
+                                           std::vector<BeesBookCommon::taglist_t> &&tileTaglists);
+};
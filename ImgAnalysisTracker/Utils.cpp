@@ -34,8 +34,6 @@ MeasureTimeRAII::~MeasureTimeRAII() {
     }
     message << std::endl;
     _notify(message.str());
-    // display message right away
-    QApplication::processEvents();
 }
 
 }
@@ -0,0 +1,444 @@
+#include "VideoEvaluation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <groundtruth/converter.h>
+
+#include "BatchRunner.h"
+#include "BoundedQueue.h"
+#include "ThreadPool.h"
+
+using namespace BeesBookCommon;
+
+namespace Batch {
+
+namespace {
+template <typename Results>
+StageCounts countResults(const size_t numGroundTruth, Results const &results) {
+    StageCounts counts;
+    counts.numGroundTruth    = numGroundTruth;
+    counts.numTruePositives  = results.truePositives.size();
+    counts.numFalsePositives = results.falsePositives.size();
+    counts.numFalseNegatives = results.falseNegatives.size();
+    return counts;
+}
+
+void writeJson(StageCounts const &counts, std::ostream &stream) {
+    stream << "{ \"groundTruth\": " << counts.numGroundTruth
+           << ", \"truePositives\": " << counts.numTruePositives
+           << ", \"falsePositives\": " << counts.numFalsePositives
+           << ", \"falseNegatives\": " << counts.numFalseNegatives
+           << ", \"precision\": " << counts.precision()
+           << ", \"recall\": " << counts.recall() << " }";
+}
+
+void writeJson(DecoderCounts const &counts, std::ostream &stream) {
+    stream << "{ \"results\": " << counts.numResults
+           << ", \"matches\": " << counts.numMatches
+           << ", \"partialMatches\": " << counts.numPartialMatches
+           << ", \"mismatches\": " << counts.numMismatches
+           << ", \"averageHamming\": " << counts.averageHamming()
+           << ", \"hammingHistogram\": [";
+    for (size_t distance = 0; distance < counts.hammingHistogram.size(); ++distance) {
+        stream << (distance ? ", " : " ") << counts.hammingHistogram[distance];
+    }
+    stream << " ], \"bitErrorRates\": [";
+    for (size_t bit = 0; bit < counts.bitErrors.size(); ++bit) {
+        stream << (bit ? ", " : " ") << counts.bitErrorRate(bit);
+    }
+    stream << " ] }";
+}
+
+template <typename Evaluation>
+void writeStagesJson(Evaluation const &evaluation, std::string const &indent, std::ostream &stream) {
+    stream << indent << "\"localizer\": ";
+    writeJson(evaluation.localizer, stream);
+    stream << ",\n" << indent << "\"ellipsefitter\": ";
+    writeJson(evaluation.ellipsefitter, stream);
+    stream << ",\n" << indent << "\"gridfitter\": ";
+    writeJson(evaluation.gridfitter, stream);
+    stream << ",\n" << indent << "\"decoder\": ";
+    writeJson(evaluation.decoder, stream);
+}
+
+void writeCsv(StageCounts const &counts, std::ostream &stream) {
+    stream << ',' << counts.numGroundTruth << ',' << counts.numTruePositives << ',' << counts.numFalsePositives
+           << ',' << counts.numFalseNegatives << ',' << counts.precision() << ',' << counts.recall();
+}
+}
+
+double StageCounts::recall() const {
+    return numGroundTruth ? static_cast<double>(numTruePositives) / static_cast<double>(numGroundTruth) : 0.;
+}
+
+double StageCounts::precision() const {
+    const size_t numDetections = numTruePositives + numFalsePositives;
+    return numDetections ? static_cast<double>(numTruePositives) / static_cast<double>(numDetections) : 0.;
+}
+
+StageCounts &StageCounts::operator+=(const StageCounts &other) {
+    numGroundTruth    += other.numGroundTruth;
+    numTruePositives  += other.numTruePositives;
+    numFalsePositives += other.numFalsePositives;
+    numFalseNegatives += other.numFalseNegatives;
+    return *this;
+}
+
+StageCounts &StageCounts::operator-=(const StageCounts &other) {
+    numGroundTruth    -= other.numGroundTruth;
+    numTruePositives  -= other.numTruePositives;
+    numFalsePositives -= other.numFalsePositives;
+    numFalseNegatives -= other.numFalseNegatives;
+    return *this;
+}
+
+const int DecoderCounts::PARTIAL_MATCH_THRESHOLD;
+const size_t DecoderCounts::NUM_BITS;
+
+void DecoderCounts::add(const GroundTruth::DecoderEvaluationResults::result_t &result) {
+    const int hammingDistance = result.hammingDistance;
+
+    ++numResults;
+    if (hammingDistance == 0) {
+        ++numMatches;
+    } else if (hammingDistance <= PARTIAL_MATCH_THRESHOLD) {
+        ++numPartialMatches;
+    } else {
+        ++numMismatches;
+    }
+    cumulHamming += static_cast<size_t>(hammingDistance);
+    ++hammingHistogram[std::min(static_cast<size_t>(hammingDistance), NUM_BITS)];
+
+    const size_t numBits = std::min(std::min(result.decodedTagIdStr.size(), result.groundTruthTagIdStr.size()),
+                                    NUM_BITS);
+    for (size_t bit = 0; bit < numBits; ++bit) {
+        if (result.decodedTagIdStr[bit] != result.groundTruthTagIdStr[bit]) {
+            ++bitErrors[bit];
+        }
+    }
+}
+
+double DecoderCounts::averageHamming() const {
+    return numResults ? static_cast<double>(cumulHamming) / static_cast<double>(numResults) : 0.;
+}
+
+double DecoderCounts::bitErrorRate(const size_t bit) const {
+    return numResults ? static_cast<double>(bitErrors.at(bit)) / static_cast<double>(numResults) : 0.;
+}
+
+DecoderCounts &DecoderCounts::operator+=(const DecoderCounts &other) {
+    numResults        += other.numResults;
+    numMatches        += other.numMatches;
+    numPartialMatches += other.numPartialMatches;
+    numMismatches     += other.numMismatches;
+    cumulHamming      += other.cumulHamming;
+    for (size_t distance = 0; distance < hammingHistogram.size(); ++distance) {
+        hammingHistogram[distance] += other.hammingHistogram[distance];
+    }
+    for (size_t bit = 0; bit < bitErrors.size(); ++bit) {
+        bitErrors[bit] += other.bitErrors[bit];
+    }
+    return *this;
+}
+
+DecoderCounts &DecoderCounts::operator-=(const DecoderCounts &other) {
+    numResults        -= other.numResults;
+    numMatches        -= other.numMatches;
+    numPartialMatches -= other.numPartialMatches;
+    numMismatches     -= other.numMismatches;
+    cumulHamming      -= other.cumulHamming;
+    for (size_t distance = 0; distance < hammingHistogram.size(); ++distance) {
+        hammingHistogram[distance] -= other.hammingHistogram[distance];
+    }
+    for (size_t bit = 0; bit < bitErrors.size(); ++bit) {
+        bitErrors[bit] -= other.bitErrors[bit];
+    }
+    return *this;
+}
+
+void EvaluationSummary::add(const FrameEvaluation &frame) {
+    ++numFrames;
+    localizer     += frame.localizer;
+    ellipsefitter += frame.ellipsefitter;
+    gridfitter    += frame.gridfitter;
+    decoder       += frame.decoder;
+}
+
+void EvaluationSummary::remove(const FrameEvaluation &frame) {
+    --numFrames;
+    localizer     -= frame.localizer;
+    ellipsefitter -= frame.ellipsefitter;
+    gridfitter    -= frame.gridfitter;
+    decoder       -= frame.decoder;
+}
+
+FrameEvaluator::FrameEvaluator(const pipeline_settings_t &settings, std::shared_ptr<const GroundTruthCache> groundTruth,
+                               const size_t numThreads, const boost::optional<TilingOptions> &tiling)
+    : _pipeline(settings, numThreads, tiling),
+      _groundTruth(std::move(groundTruth)) {
+}
+
+FrameEvaluation FrameEvaluator::evaluate(const size_t frameNumber, const cv::Mat &frameGray) {
+    const auto start = std::chrono::steady_clock::now();
+
+    FrameEvaluation frame;
+    frame.frameNumber = frameNumber;
+
+    // only the annotations of this frame are decoded. The evaluation keeps references to
+    // the tags of the evaluated stages, both taglists have to stay in place until all
+    // stages have been evaluated
+    GroundTruthEvaluation evaluation(gtConverter::ResultsFromSerializationData(*_groundTruth->getFrame(frameNumber)));
+
+    const taglist_t localizerTaglist = _pipeline.localize(frameGray);
+    evaluation.evaluateLocalizer(frameNumber, localizerTaglist);
+
+    taglist_t taglist = _pipeline.getTagStages().processEllipseFitter(taglist_t(localizerTaglist));
+    evaluation.evaluateEllipseFitter(taglist);
+
+    taglist = _pipeline.getTagStages().processGridFitter(std::move(taglist));
+    evaluation.evaluateGridFitter();
+
+    taglist = _pipeline.getTagStages().processDecoder(std::move(taglist));
+    evaluation.evaluateDecoder();
+
+    countEvaluation(evaluation, frame);
+
+    const auto end = std::chrono::steady_clock::now();
+    frame.processingMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+    return frame;
+}
+
+std::string escapeJson(const std::string &value) {
+    std::string escaped;
+    for (const char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+void countEvaluation(const GroundTruthEvaluation &evaluation, FrameEvaluation &frame) {
+    const GroundTruth::LocalizerEvaluationResults &localizerResults = evaluation.getLocalizerResults();
+    frame.localizer = countResults(localizerResults.taggedGridsOnFrame.size(), localizerResults);
+
+    const GroundTruth::EllipseFitterEvaluationResults &ellipsefitterResults = evaluation.getEllipsefitterResults();
+    frame.ellipsefitter = countResults(ellipsefitterResults.taggedGridsOnFrame.size(), ellipsefitterResults);
+
+    frame.gridfitter = countResults(ellipsefitterResults.taggedGridsOnFrame.size(),
+                                    evaluation.getGridfitterResults());
+
+    for (const GroundTruth::DecoderEvaluationResults::result_t &result :
+            evaluation.getDecoderResults().evaluationResults) {
+        frame.decoder.add(result);
+    }
+}
+
+void readFrames(const std::string &inputPath, const FrameFormat inputFormat, const std::vector<size_t> &frameNumbers,
+                const std::function<bool (size_t, const cv::Mat &)> &consumer,
+                const size_t logInterval, std::ostream &log) {
+    const FrameIngestion ingestion(inputFormat);
+    FrameSource source(inputPath, ingestion.requiresRawFrames());
+
+    size_t numRead = 0;
+    for (const size_t frameNumber : frameNumbers) {
+        while (source.getNextFrameNumber() < frameNumber) {
+            if (!source.skip()) {
+                break;
+            }
+        }
+
+        cv::Mat frame;
+        if (!source.read(frame)) {
+            log << "Input ends before frame " << frameNumber << std::endl;
+            break;
+        }
+
+        cv::Mat frameGray;
+        ingestion.toGray(frame, frameGray);
+
+        if (!consumer(source.getFrameNumber(), frameGray)) {
+            break;
+        }
+
+        ++numRead;
+        if (logInterval && (numRead % logInterval == 0)) {
+            log << numRead << "/" << frameNumbers.size() << " frames read" << std::endl;
+        }
+    }
+}
+
+void writeEvaluationJson(const EvaluationOptions &options, const EvaluationSummary &summary,
+                         const std::vector<FrameEvaluation> &frames, std::ostream &stream) {
+    stream << std::setprecision(6);
+    stream << "{\n"
+           << "  \"config\": \"" << escapeJson(options.configPath) << "\",\n"
+           << "  \"video\": \"" << escapeJson(options.inputPath) << "\",\n"
+           << "  \"groundTruth\": \"" << escapeJson(options.groundTruthPath) << "\",\n"
+           << "  \"numFrames\": " << summary.numFrames << ",\n"
+           << "  \"seconds\": " << summary.seconds << ",\n"
+           << "  \"summary\": {\n";
+    writeStagesJson(summary, "    ", stream);
+    stream << "\n  },\n"
+           << "  \"frames\": [";
+
+    for (size_t idx = 0; idx < frames.size(); ++idx) {
+        const FrameEvaluation &frame = frames[idx];
+        stream << (idx ? ",\n" : "\n") << "    {\n"
+               << "      \"frame\": " << frame.frameNumber << ",\n"
+               << "      \"processingMs\": " << frame.processingMs << ",\n";
+        writeStagesJson(frame, "      ", stream);
+        stream << "\n    }";
+    }
+
+    stream << "\n  ]\n}\n";
+}
+
+void writeEvaluationCsv(const std::vector<FrameEvaluation> &frames, std::ostream &stream) {
+    stream << std::setprecision(6);
+
+    stream << "frame";
+    for (const char *stage : { "localizer", "ellipsefitter", "gridfitter" }) {
+        for (const char *column : { "gt", "tp", "fp", "fn", "precision", "recall" }) {
+            stream << ',' << stage << '_' << column;
+        }
+    }
+    stream << ",decoder_results,decoder_matches,decoder_partial_matches,decoder_mismatches,decoder_avg_hamming"
+           << ",processing_ms\n";
+
+    for (const FrameEvaluation &frame : frames) {
+        stream << frame.frameNumber;
+        writeCsv(frame.localizer, stream);
+        writeCsv(frame.ellipsefitter, stream);
+        writeCsv(frame.gridfitter, stream);
+        stream << ',' << frame.decoder.numResults << ',' << frame.decoder.numMatches
+               << ',' << frame.decoder.numPartialMatches << ',' << frame.decoder.numMismatches
+               << ',' << frame.decoder.averageHamming() << ',' << frame.processingMs << '\n';
+    }
+}
+
+EvaluationSummary runEvaluation(const EvaluationOptions &options, std::ostream &log) {
+    const pipeline_settings_t settings = loadPipelineSettings(options.configPath);
+
+    const std::shared_ptr<const GroundTruthCache> groundTruth =
+        std::make_shared<GroundTruthCache>(options.groundTruthPath);
+    std::vector<size_t> annotatedFrames = groundTruth->getFrameNumbers();
+    if (options.maxFrames && annotatedFrames.size() > options.maxFrames.get()) {
+        annotatedFrames.resize(options.maxFrames.get());
+    }
+    log << annotatedFrames.size() << " annotated frames in " << options.groundTruthPath
+        << " (cache " << groundTruth->getCachePath() << ")" << std::endl;
+
+    struct Job {
+        size_t frameNumber;
+        cv::Mat frameGray;
+    };
+
+    BoundedQueue<Job> queue(options.queueCapacity);
+    std::vector<FrameEvaluation> frames;
+    std::mutex framesMutex;
+    std::exception_ptr error;
+
+    const size_t numInstances = std::max<size_t>(1, std::min(ThreadPool::resolveNumThreads(options.numInstances),
+                                annotatedFrames.size()));
+    log << "Running " << numInstances << " pipeline instances" << std::endl;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t idx = 0; idx < numInstances; ++idx) {
+        threads.emplace_back([&]() {
+            try {
+                FrameEvaluator evaluator(settings, groundTruth, options.numThreads, options.tiling);
+
+                Job job;
+                while (queue.pop(job)) {
+                    const FrameEvaluation frame = evaluator.evaluate(job.frameNumber, job.frameGray);
+
+                    const std::lock_guard<std::mutex> lock(framesMutex);
+                    frames.push_back(frame);
+                }
+            } catch (...) {
+                {
+                    const std::lock_guard<std::mutex> lock(framesMutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+                // abort the other instances and the frame source
+                queue.close();
+            }
+        });
+    }
+
+    // frames are decoded sequentially, frames without annotations are skipped
+    try {
+        readFrames(options.inputPath, options.inputFormat, annotatedFrames,
+        [&](const size_t frameNumber, const cv::Mat & frameGray) {
+            return queue.push(Job { frameNumber, frameGray });
+        }, options.logInterval, log);
+    } catch (...) {
+        const std::lock_guard<std::mutex> lock(framesMutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+
+    queue.close();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    std::sort(frames.begin(), frames.end(), [](FrameEvaluation const & lhs, FrameEvaluation const & rhs) {
+        return lhs.frameNumber < rhs.frameNumber;
+    });
+
+    EvaluationSummary summary;
+    for (const FrameEvaluation &frame : frames) {
+        summary.add(frame);
+    }
+    summary.seconds = std::chrono::duration<double>(end - start).count();
+
+    std::ofstream json(options.outputPath + ".json");
+    if (!json) {
+        throw std::runtime_error("unable to open output file " + options.outputPath + ".json");
+    }
+    writeEvaluationJson(options, summary, frames, json);
+
+    std::ofstream csv(options.outputPath + ".csv");
+    if (!csv) {
+        throw std::runtime_error("unable to open output file " + options.outputPath + ".csv");
+    }
+    writeEvaluationCsv(frames, csv);
+
+    log << "Evaluated " << summary.numFrames << " frames in " << summary.seconds << "s" << std::endl;
+    for (const auto &stage : {
+                std::make_pair("Localizer", summary.localizer),
+                std::make_pair("EllipseFitter", summary.ellipsefitter),
+                std::make_pair("GridFitter", summary.gridfitter)
+            }) {
+        log << "  " << stage.first << ": precision " << stage.second.precision()
+            << ", recall " << stage.second.recall() << std::endl;
+    }
+    log << "  Decoder: " << summary.decoder.numMatches << "/" << summary.decoder.numResults
+        << " matches, average hamming distance " << summary.decoder.averageHamming() << std::endl;
+
+    return summary;
+}
+
+}
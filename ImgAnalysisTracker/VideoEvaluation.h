@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include <pipeline/util/GroundTruthEvaluator.h>
+
+#include "Common.h"
+#include "FrameIngestion.h"
+#include "GroundTruthCache.h"
+#include "PipelineInstance.h"
+#include "TiledLocalizer.h"
+
+namespace Batch {
+
+/**
+ * detection results of one stage compared to the ground truth
+ */
+struct StageCounts {
+    size_t numGroundTruth    = 0;
+    size_t numTruePositives  = 0;
+    size_t numFalsePositives = 0;
+    size_t numFalseNegatives = 0;
+
+    double recall() const;
+    double precision() const;
+
+    StageCounts &operator+=(StageCounts const &other);
+    StageCounts &operator-=(StageCounts const &other);
+};
+
+/**
+ * hamming distances between the decoded and the ground truth ids
+ */
+struct DecoderCounts {
+    // distances up to this threshold are counted as partial matches (same as in the GUI)
+    static const int PARTIAL_MATCH_THRESHOLD = 3;
+    static const size_t NUM_BITS = 12;
+
+    size_t numResults        = 0;
+    size_t numMatches        = 0;
+    size_t numPartialMatches = 0;
+    size_t numMismatches     = 0;
+    size_t cumulHamming      = 0;
+    // number of results per hamming distance
+    std::array<size_t, NUM_BITS + 1> hammingHistogram {};
+    // number of results per wrongly decoded bit, in the order of the id strings
+    std::array<size_t, NUM_BITS> bitErrors {};
+
+    void add(GroundTruth::DecoderEvaluationResults::result_t const &result);
+    double averageHamming() const;
+    double bitErrorRate(size_t bit) const;
+
+    DecoderCounts &operator+=(DecoderCounts const &other);
+    DecoderCounts &operator-=(DecoderCounts const &other);
+};
+
+struct FrameEvaluation {
+    size_t frameNumber = 0;
+    StageCounts localizer;
+    StageCounts ellipsefitter;
+    StageCounts gridfitter;
+    DecoderCounts decoder;
+    double processingMs = 0.;
+};
+
+/**
+ * sum of the counts of all evaluated frames, i.e. precision and recall are micro averaged
+ */
+struct EvaluationSummary {
+    size_t numFrames = 0;
+    StageCounts localizer;
+    StageCounts ellipsefitter;
+    StageCounts gridfitter;
+    DecoderCounts decoder;
+    double seconds = 0.;
+
+    void add(FrameEvaluation const &frame);
+    // the frame has to have been added before
+    void remove(FrameEvaluation const &frame);
+};
+
+struct EvaluationOptions {
+    std::string configPath;
+    std::string inputPath;
+    std::string groundTruthPath;
+    // the report is written to <outputPath>.json and <outputPath>.csv
+    std::string outputPath;
+    FrameFormat inputFormat = FrameFormat::Auto;
+    // evaluate only the first n annotated frames
+    boost::optional<size_t> maxFrames;
+    // pipeline instances evaluating frames in parallel (0: number of hardware threads)
+    size_t numInstances = 0;
+    size_t queueCapacity = 4;
+    // threads of the per-tag stages of each instance
+    size_t numThreads = 1;
+    boost::optional<TilingOptions> tiling;
+    size_t logInterval = 100;
+};
+
+/**
+ * runs all stages on a frame and evaluates each of them against the ground truth.
+ * Not thread-safe, every thread needs its own instance.
+ */
+class FrameEvaluator {
+  public:
+    FrameEvaluator(BeesBookCommon::pipeline_settings_t const &settings,
+                   std::shared_ptr<const GroundTruthCache> groundTruth,
+                   size_t numThreads = 1, boost::optional<TilingOptions> const &tiling = boost::none);
+
+    FrameEvaluation evaluate(size_t frameNumber, cv::Mat const &frameGray);
+
+  private:
+    PipelineInstance _pipeline;
+    std::shared_ptr<const GroundTruthCache> _groundTruth;
+};
+
+/**
+ * escape a string for a JSON string literal
+ */
+std::string escapeJson(std::string const &value);
+
+/**
+ * count the results of all stages of an evaluation, the decoder has to be evaluated
+ */
+void countEvaluation(GroundTruthEvaluation const &evaluation, FrameEvaluation &frame);
+
+/**
+ * decode the given frames of the input in order and pass them to consumer as
+ * grayscale images. Stops early if the consumer returns false.
+ *
+ * @param frameNumbers sorted numbers of the frames to read
+ * @param log progress messages are written to this stream
+ */
+void readFrames(std::string const &inputPath, FrameFormat inputFormat, std::vector<size_t> const &frameNumbers,
+                std::function<bool(size_t frameNumber, cv::Mat const &frameGray)> const &consumer,
+                size_t logInterval, std::ostream &log);
+
+void writeEvaluationJson(EvaluationOptions const &options, EvaluationSummary const &summary,
+                         std::vector<FrameEvaluation> const &frames, std::ostream &stream);
+void writeEvaluationCsv(std::vector<FrameEvaluation> const &frames, std::ostream &stream);
+
+/**
+ * evaluate all stages on every annotated frame of options.groundTruthPath, the frames are
+ * distributed to options.numInstances pipeline instances
+ *
+ * @param log progress and timing messages are written to this stream
+ */
+EvaluationSummary runEvaluation(EvaluationOptions const &options, std::ostream &log);
+
+}
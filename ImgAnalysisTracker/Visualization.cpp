@@ -1,5 +1,10 @@
 #include "Visualization.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
 #include <biotracker/util/CvHelper.h>
 #include <pipeline/datastructure/Ellipse.h>
 #include <pipeline/datastructure/Tag.h>
@@ -8,7 +13,20 @@ namespace BC = BioTracker::Core;
 
 namespace Visualization {
 
-void drawEllipse(const pipeline::Tag &tag, QPen &pen, QPainter *painter, const pipeline::Ellipse &ellipse) {
+constexpr double OverlayBatch::MIN_TEXT_SCALE;
+constexpr double OverlayBatch::MIN_SHAPE_SCALE;
+
+OverlayBatch::OverlayBatch()
+    : _maxExtent(0.) {
+}
+
+void OverlayBatch::addBox(const cv::Rect &box, const QColor &color) {
+    QPainterPath path;
+    path.addRect(BC::CvHelper::toQt(box));
+    addShape(path, color);
+}
+
+void OverlayBatch::addEllipse(const pipeline::Tag &tag, const pipeline::Ellipse &ellipse, const QColor &color) {
     static const QPoint offset(20, -20);
 
     cv::RotatedRect ellipseBox(ellipse.getCen(), ellipse.getAxis(), static_cast<float>(ellipse.getAngle()));
@@ -18,36 +36,133 @@ void drawEllipse(const pipeline::Tag &tag, QPen &pen, QPainter *painter, const p
     qreal rx = static_cast<qreal>(ellipse.getAxis().width);
     qreal ry = static_cast<qreal>(ellipse.getAxis().height);
 
-    //draw ellipse
-    painter->save();
-    painter->translate(tag.getRoi().x +center.x() ,tag.getRoi().y+center.y());
-    painter->rotate(-ellipse.getAngle());
-    painter->drawEllipse(QPointF(0,0),rx,ry);
-    painter->restore();
+    //add rotated ellipse
+    QPainterPath ellipsePath;
+    ellipsePath.addEllipse(QPointF(0, 0), rx, ry);
+
+    QTransform transform;
+    transform.translate(tag.getRoi().x + center.x(), tag.getRoi().y + center.y());
+    transform.rotate(-ellipse.getAngle());
+
+    addShape(transform.map(ellipsePath), color);
+
+    //add score
+    addText(QPoint(tag.getRoi().x, tag.getRoi().y) + BC::CvHelper::toQt(ellipseBox.boundingRect().tl()) + offset,
+            "Score: " + QString::number(ellipse.getVote()), color);
+}
+
+void OverlayBatch::addText(const QPoint &baseline, const QString &text, const QColor &color) {
+    QStaticText staticText(text);
+    staticText.setPerformanceHint(QStaticText::AggressiveCaching);
+
+    getBatch(baseline, color).texts.push_back({ baseline, staticText });
+}
+
+void OverlayBatch::addShape(const QPainterPath &shape, const QColor &color) {
+    const QRectF bounds = shape.boundingRect();
+    _maxExtent = std::max({ _maxExtent, bounds.width(), bounds.height() });
+
+    ColorBatch &batch = getBatch(bounds.center(), color);
+    batch.path.addPath(shape);
+    batch.markers.append(bounds.center());
+}
+
+void OverlayBatch::clear() {
+    _cells.clear();
+    _maxExtent = 0.;
+}
+
+void OverlayBatch::draw(QPainter *painter, QPen pen) const {
+    const QTransform &transform = painter->combinedTransform();
+
+    // part of the frame that is visible, extended by the largest item so that items
+    // reaching into the visible area from a neighbouring cell are not culled
+    const qreal margin = std::max(_maxExtent, static_cast<qreal>(TEXT_MARGIN));
+    const QRectF visible = transform.inverted().mapRect(QRectF(painter->viewport()))
+                           .adjusted(-margin, -margin, margin, margin);
+
+    // zoom factor of the view (screen pixels per frame pixel)
+    const double scale = std::sqrt(std::abs(transform.determinant()));
+    const bool drawTexts  = scale >= MIN_TEXT_SCALE;
+    const bool drawShapes = scale >= MIN_SHAPE_SCALE;
 
-    //draw score
-    painter->setPen(pen);
     painter->save();
-    painter->translate(tag.getRoi().x,tag.getRoi().y);
-    painter->drawText(BC::CvHelper::toQt(ellipseBox.boundingRect().tl()) + offset,
-                      "Score: " + QString::number(ellipse.getVote()));
+    painter->setBrush(Qt::NoBrush);
+    if (!drawShapes) {
+        pen.setWidth(3);
+    }
+
+    // static texts are positioned by their top left corner
+    const qreal ascent = painter->fontMetrics().ascent();
+
+    const cell_index_t first = getCellIndex(visible.topLeft());
+    const cell_index_t last  = getCellIndex(visible.bottomRight());
+
+    for (auto it = _cells.lower_bound(first); it != _cells.end() && it->first.first <= last.first; ++it) {
+        const cell_index_t &index = it->first;
+        if (index.second < first.second || index.second > last.second) {
+            continue;
+        }
+
+        for (const ColorBatch &batch : it->second.batches) {
+            pen.setColor(batch.color);
+            painter->setPen(pen);
+
+            if (drawShapes) {
+                painter->drawPath(batch.path);
+            } else {
+                painter->drawPoints(batch.markers);
+            }
+
+            if (drawTexts) {
+                for (const Text &text : batch.texts) {
+                    painter->drawStaticText(text.baseline - QPointF(0., ascent), text.text);
+                }
+            }
+        }
+    }
+
     painter->restore();
 }
 
-void drawBox(const cv::Rect &box, QPainter *painter, QPen &pen) {
-    const QRect qbox = BC::CvHelper::toQt(box);
-    painter->setPen(pen);
-    painter->drawRect(qbox);
+OverlayBatch::ColorBatch &OverlayBatch::getBatch(const QPointF &position, const QColor &color) {
+    Cell &cell = _cells[getCellIndex(position)];
+
+    for (ColorBatch &batch : cell.batches) {
+        if (batch.color == color) {
+            return batch;
+        }
+    }
+
+    cell.batches.push_back({ color, QPainterPath(), QPolygonF(), std::vector<Text>() });
+    return cell.batches.back();
+}
+
+OverlayBatch::cell_index_t OverlayBatch::getCellIndex(const QPointF &position) {
+    return cell_index_t(static_cast<int>(std::floor(position.x() / CELL_SIZE)),
+                        static_cast<int>(std::floor(position.y() / CELL_SIZE)));
 }
 
 cv::Mat rgbMatFromBwMat(const cv::Mat &mat, const int type) {
-    // TODO: convert B&W to RGB
-    // this could probably be implemented more efficiently
+    // single pass gray to BGR expansion, the depth only has to be converted
+    // if the target is not 8 bit
     cv::Mat image;
-    cv::Mat channels[3] = { mat.clone(), mat.clone(), mat.clone() };
-    cv::merge(channels, 3, image);
-    image.convertTo(image, type);
+    cv::cvtColor(mat, image, CV_GRAY2BGR);
+    if (image.depth() != CV_MAT_DEPTH(type)) {
+        image.convertTo(image, type);
+    }
     return image;
 }
 
+const cv::Mat &DisplayCache::get(const size_t frameNumber, const std::string &viewName, const int type,
+                                 const source_t &source) {
+    const key_t key(frameNumber, viewName, type);
+
+    auto it = _images.find(key);
+    if (it == _images.end()) {
+        it = _images.emplace(key, rgbMatFromBwMat(source(), type)).first;
+    }
+    return it->second;
+}
+
 }
@@ -1,8 +1,19 @@
 #pragma once
 
+#include <functional>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 #include <opencv2/core/core.hpp>
+#include <QColor>
 #include <QPainter>
+#include <QPainterPath>
 #include <QPen>
+#include <QPolygonF>
+#include <QStaticText>
 
 namespace pipeline {
 class Ellipse;
@@ -11,10 +22,108 @@ class Tag;
 
 namespace Visualization {
 
-void drawEllipse(const pipeline::Tag &tag, QPen &pen, QPainter *painter, const pipeline::Ellipse &ellipse);
+static const QColor QCOLOR_ORANGE(255, 102, 0);
+static const QColor QCOLOR_GREEN(0, 255, 0);
+static const QColor QCOLOR_RED(255, 0, 0);
+static const QColor QCOLOR_BLUE(0, 0, 255);
+static const QColor QCOLOR_LIGHT_BLUE(150, 200, 255);
+static const QColor QCOLOR_GREENISH(182, 255, 13);
+
+/**
+ * retained overlay: the shapes of all tags are collected once per tracking result
+ * into one path per color and the texts are laid out once, so a repaint only replays
+ * a few draw calls instead of setting the pen and drawing every tag separately.
+ *
+ * The items are stored in a uniform grid of cells over the frame. draw() only replays
+ * the cells that intersect the visible part of the frame and reduces the level of detail
+ * when zoomed out: texts are skipped first, then shapes are replaced by point markers.
+ */
+class OverlayBatch {
+  public:
+    OverlayBatch();
+
+    void addBox(const cv::Rect &box, const QColor &color);
+
+    /**
+     * ellipse of the tag candidate and its score
+     */
+    void addEllipse(const pipeline::Tag &tag, const pipeline::Ellipse &ellipse, const QColor &color);
+
+    /**
+     * @param baseline left end of the text baseline, as for QPainter::drawText
+     */
+    void addText(const QPoint &baseline, const QString &text, const QColor &color);
+
+    void clear();
+
+    /**
+     * @param pen pen used for all shapes and texts, only its color is replaced
+     */
+    void draw(QPainter *painter, QPen pen) const;
+
+  private:
+    // edge length of the grid cells in frame pixels
+    static const int CELL_SIZE = 256;
+    // below this zoom factor no texts are drawn
+    static constexpr double MIN_TEXT_SCALE = 0.35;
+    // below this zoom factor shapes are drawn as point markers
+    static constexpr double MIN_SHAPE_SCALE = 0.12;
+    // texts are not measured, they are assumed to extend at most this far from their anchor
+    static const int TEXT_MARGIN = 256;
+
+    struct Text {
+        QPointF baseline;
+        QStaticText text;
+    };
 
-void drawBox(const cv::Rect &box, QPainter *painter, QPen &pen);
+    struct ColorBatch {
+        QColor color;
+        QPainterPath path;
+        // one point per shape for the lowest level of detail
+        QPolygonF markers;
+        std::vector<Text> texts;
+    };
+
+    struct Cell {
+        // few distinct colors, a linear search is faster than a map
+        std::vector<ColorBatch> batches;
+    };
+
+    typedef std::pair<int, int> cell_index_t;
+
+    std::map<cell_index_t, Cell> _cells;
+    // items are stored in the cell of their center, the largest item extent
+    // determines how far the visible area has to be extended when querying cells
+    qreal _maxExtent;
+
+    ColorBatch &getBatch(const QPointF &position, const QColor &color);
+    void addShape(const QPainterPath &shape, const QColor &color);
+    static cell_index_t getCellIndex(const QPointF &position);
+};
 
 cv::Mat rgbMatFromBwMat(const cv::Mat &mat, const int type);
 
+/**
+ * display conversions of the views, so repainting the same view (e.g. while panning
+ * or zooming) does not convert the image again. The cache has to be cleared whenever
+ * tracking produces new view data.
+ */
+class DisplayCache {
+  public:
+    typedef std::function<cv::Mat()> source_t;
+
+    /**
+     * @param source view image in its original format, only called on a cache miss
+     * @return view image converted to type
+     */
+    cv::Mat const &get(size_t frameNumber, std::string const &viewName, int type, source_t const &source);
+
+    void clear() { _images.clear(); }
+
+  private:
+    typedef std::tuple<size_t, std::string, int> key_t;
+
+    std::map<key_t, cv::Mat> _images;
+};
+
 }
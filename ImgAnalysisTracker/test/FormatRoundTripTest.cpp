@@ -0,0 +1,322 @@
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "BinaryTaglist.h"
+#include "RleImage.h"
+
+/**
+ * encode -> decode round trips of the binary taglist and the run-length encoded image
+ * formats. Exits with 1 if any check failed.
+ */
+namespace {
+size_t numFailures = 0;
+
+#define CHECK(condition) \
+    if (!(condition)) { \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+        ++numFailures; \
+    }
+
+using BeesBookCommon::taglist_t;
+
+/**
+ * temporary directory, removed with all its files on destruction
+ */
+class TemporaryDirectory {
+  public:
+    TemporaryDirectory()
+        : _path(boost::filesystem::temp_directory_path() /
+                boost::filesystem::unique_path("bbtest-%%%%-%%%%-%%%%")) {
+        boost::filesystem::create_directories(_path);
+    }
+
+    ~TemporaryDirectory() {
+        boost::system::error_code error;
+        boost::filesystem::remove_all(_path, error);
+    }
+
+    std::string file(std::string const &name) const {
+        return (_path / name).string();
+    }
+
+  private:
+    boost::filesystem::path _path;
+};
+
+pipeline::Tag makeTag(int x, unsigned long long id, bool valid) {
+    pipeline::Tag tag(cv::Rect(x, 2 * x, 100, 90), id);
+    tag.setValid(valid);
+    return tag;
+}
+
+pipeline::Tag makeDecodedTag(int x) {
+    pipeline::Tag tag = makeTag(x, 42, true);
+    for (int vote = 0; vote < 2; ++vote) {
+        pipeline::TagCandidate candidate(pipeline::Ellipse(1000 - vote, cv::Point2i(x + 50, x + 45),
+                                         cv::Size(22, 19), 0.5, cv::Size(100, 90)));
+        candidate.getGrids().push_back(PipelineGrid(cv::Point2i(x + 51, x + 44), 24.5, 0.25, -0.5, 0.125));
+        candidate.setDecodings({ pipeline::decoding_t(0xABC), pipeline::decoding_t(0x123) });
+        tag.getCandidates().push_back(candidate);
+    }
+    return tag;
+}
+
+bool equalTags(pipeline::Tag const &expected, pipeline::Tag const &actual) {
+    if (expected.getRoi() != actual.getRoi() || expected.getId() != actual.getId() ||
+            expected.isValid() != actual.isValid() ||
+            expected.getCandidatesConst().size() != actual.getCandidatesConst().size()) {
+        return false;
+    }
+
+    for (size_t idx = 0; idx < expected.getCandidatesConst().size(); ++idx) {
+        const pipeline::TagCandidate &expectedCandidate = expected.getCandidatesConst()[idx];
+        const pipeline::TagCandidate &actualCandidate   = actual.getCandidatesConst()[idx];
+        const pipeline::Ellipse &expectedEllipse = expectedCandidate.getEllipse();
+        const pipeline::Ellipse &actualEllipse   = actualCandidate.getEllipse();
+
+        // all floating point values are exactly representable as float32
+        if (expectedEllipse.getVote() != actualEllipse.getVote() ||
+                expectedEllipse.getCen() != actualEllipse.getCen() ||
+                expectedEllipse.getAxis() != actualEllipse.getAxis() ||
+                expectedEllipse.getAngle() != actualEllipse.getAngle() ||
+                expectedEllipse.getRoiSize() != actualEllipse.getRoiSize() ||
+                expectedCandidate.getDecodings() != actualCandidate.getDecodings() ||
+                expectedCandidate.getGridsConst().size() != actualCandidate.getGridsConst().size()) {
+            return false;
+        }
+
+        for (size_t gridIdx = 0; gridIdx < expectedCandidate.getGridsConst().size(); ++gridIdx) {
+            const PipelineGrid &expectedGrid = expectedCandidate.getGridsConst()[gridIdx];
+            const PipelineGrid &actualGrid   = actualCandidate.getGridsConst()[gridIdx];
+            if (expectedGrid.getCenter() != actualGrid.getCenter() ||
+                    expectedGrid.getRadius() != actualGrid.getRadius() ||
+                    expectedGrid.getZRotation() != actualGrid.getZRotation() ||
+                    expectedGrid.getYRotation() != actualGrid.getYRotation() ||
+                    expectedGrid.getXRotation() != actualGrid.getXRotation()) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool equalTaglists(taglist_t const &expected, taglist_t const &actual) {
+    if (expected.size() != actual.size()) {
+        return false;
+    }
+    for (size_t idx = 0; idx < expected.size(); ++idx) {
+        if (!equalTags(expected[idx], actual[idx])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+taglist_t roundTrip(taglist_t const &taglist) {
+    std::string buffer;
+    BinaryTaglist::encode(taglist, buffer);
+    return BinaryTaglist::decode(buffer.data(), buffer.size());
+}
+
+bool equalImages(cv::Mat const &expected, cv::Mat const &actual) {
+    if (expected.size() != actual.size() || expected.type() != actual.type()) {
+        return false;
+    }
+    for (int row = 0; row < expected.rows; ++row) {
+        for (int col = 0; col < expected.cols; ++col) {
+            if (expected.at<uint8_t>(row, col) != actual.at<uint8_t>(row, col)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void testEmptyTaglist() {
+    std::string buffer;
+    BinaryTaglist::encode(taglist_t(), buffer);
+    // only the number of tags
+    CHECK(buffer.size() == 4);
+    CHECK(BinaryTaglist::decode(buffer.data(), buffer.size()).empty());
+}
+
+void testTagsWithoutCandidates() {
+    const taglist_t taglist { makeTag(0, 0, true), makeTag(-7, 1, false),
+                              makeTag(1 << 20, 0xFFFFFFFFFFFFull, true) };
+    CHECK(equalTaglists(taglist, roundTrip(taglist)));
+}
+
+void testTagsWithCandidates() {
+    const taglist_t taglist { makeDecodedTag(10), makeTag(20, 3, false), makeDecodedTag(30) };
+    CHECK(equalTaglists(taglist, roundTrip(taglist)));
+}
+
+void testIncompletePayload() {
+    const taglist_t taglist { makeDecodedTag(10) };
+    std::string buffer;
+    BinaryTaglist::encode(taglist, buffer);
+
+    bool thrown = false;
+    try {
+        BinaryTaglist::decode(buffer.data(), buffer.size() - 1);
+    } catch (std::runtime_error const &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+void testTruncatedLastRecord() {
+    const TemporaryDirectory directory;
+    const std::string path = directory.file("truncated.bbtags");
+
+    const taglist_t first { makeDecodedTag(10) };
+    const taglist_t second { makeTag(20, 5, true), makeDecodedTag(30) };
+    const taglist_t third { makeTag(40, 6, false) };
+    {
+        Batch::BinaryTaglistWriter writer(path);
+        writer.write(0, first);
+        writer.write(1, second);
+    }
+    const uint64_t completeSize = boost::filesystem::file_size(path);
+    {
+        Batch::BinaryTaglistWriter writer(path);
+        writer.write(2, third);
+    }
+    // cut the last record in the middle of its payload, as if writing it was interrupted
+    boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - 3);
+
+    {
+        const Batch::BinaryTaglistReader reader(path);
+        CHECK(reader.getNumFrames() == 2);
+        CHECK(!reader.hasFrame(2));
+        CHECK(reader.getValidSize() == completeSize);
+        CHECK(equalTaglists(second, reader.read(1)));
+    }
+
+    // continuing the file removes the incomplete record first
+    {
+        Batch::BinaryTaglistWriter writer(path);
+        writer.write(2, third);
+    }
+    const Batch::BinaryTaglistReader reader(path);
+    CHECK(reader.getFrameNumbers() == std::vector<size_t>({ 0, 1, 2 }));
+    CHECK(reader.getValidSize() == boost::filesystem::file_size(path));
+    CHECK(equalTaglists(first, reader.read(0)));
+    CHECK(equalTaglists(second, reader.read(1)));
+    CHECK(equalTaglists(third, reader.read(2)));
+}
+
+void testTruncatedRecordHeader() {
+    const TemporaryDirectory directory;
+    const std::string path = directory.file("header.bbtags");
+    {
+        Batch::BinaryTaglistWriter writer(path);
+        writer.write(7, taglist_t());
+        writer.write(8, taglist_t { makeTag(1, 2, true) });
+    }
+    // keep only a part of the header of the second record
+    const uint64_t firstEnd = BinaryTaglist::HEADER_SIZE + BinaryTaglist::RECORD_HEADER_SIZE + 4;
+    boost::filesystem::resize_file(path, firstEnd + 5);
+
+    const Batch::BinaryTaglistReader reader(path);
+    CHECK(reader.getFrameNumbers() == std::vector<size_t>({ 7 }));
+    CHECK(reader.getValidSize() == firstEnd);
+    CHECK(reader.read(7).empty());
+}
+
+void testRleUniformImage() {
+    const cv::Mat image = cv::Mat::zeros(300, 400, CV_8UC1);
+    const RleImage rle(image);
+    CHECK(rle.getNumRuns() == 1);
+    // 120000 - 1 takes three varint bytes
+    CHECK(rle.getEncodedSize() == 4);
+    CHECK(equalImages(image, rle.decode()));
+}
+
+void testRleLongRunsAcrossRows() {
+    cv::Mat image = cv::Mat::zeros(50, 100, CV_8UC1);
+    // run of exactly 128 pixels (longest run with a one byte length) crossing row 0 -> 1
+    for (int idx = 60; idx < 60 + 128; ++idx) {
+        image.at<uint8_t>(idx / image.cols, idx % image.cols) = 255;
+    }
+    // run of 129 pixels (shortest run with a two byte length) crossing rows 3 -> 4
+    for (int idx = 350; idx < 350 + 129; ++idx) {
+        image.at<uint8_t>(idx / image.cols, idx % image.cols) = 7;
+    }
+    // run spanning several complete rows
+    for (int idx = 1050; idx < 1050 + 1000; ++idx) {
+        image.at<uint8_t>(idx / image.cols, idx % image.cols) = 1;
+    }
+    // single pixels at the end of a row and at the beginning of the next one
+    image.at<uint8_t>(30, 99) = 3;
+    image.at<uint8_t>(31, 0)  = 4;
+    // last pixel of the image
+    image.at<uint8_t>(49, 99) = 9;
+
+    const RleImage rle(image);
+    CHECK(rle.size() == image.size());
+    CHECK(rle.getNumRuns() == 11);
+    CHECK(equalImages(image, rle.decode()));
+
+    // decoding into an image of the wrong size reallocates it
+    cv::Mat decoded = cv::Mat::zeros(5, 5, CV_8UC1);
+    rle.decode(decoded);
+    CHECK(equalImages(image, decoded));
+}
+
+void testRleAlternatingPixels() {
+    cv::Mat image(3, 257, CV_8UC1);
+    for (int row = 0; row < image.rows; ++row) {
+        for (int col = 0; col < image.cols; ++col) {
+            image.at<uint8_t>(row, col) = static_cast<uint8_t>((row * image.cols + col) % 2);
+        }
+    }
+
+    const RleImage rle(image);
+    CHECK(rle.getNumRuns() == static_cast<size_t>(image.rows * image.cols));
+    CHECK(rle.getEncodedSize() == 2 * rle.getNumRuns());
+    CHECK(equalImages(image, rle.decode()));
+}
+
+void testRleEmptyImage() {
+    const RleImage rle((cv::Mat(0, 0, CV_8UC1)));
+    CHECK(rle.empty());
+    CHECK(rle.getNumRuns() == 0);
+    CHECK(rle.decode().empty());
+}
+
+void run(const char *name, std::function<void()> const &test) {
+    try {
+        test();
+    } catch (std::exception const &e) {
+        std::cerr << name << ": unexpected exception: " << e.what() << std::endl;
+        ++numFailures;
+    }
+}
+}
+
+int main() {
+    run("testEmptyTaglist", testEmptyTaglist);
+    run("testTagsWithoutCandidates", testTagsWithoutCandidates);
+    run("testTagsWithCandidates", testTagsWithCandidates);
+    run("testIncompletePayload", testIncompletePayload);
+    run("testTruncatedLastRecord", testTruncatedLastRecord);
+    run("testTruncatedRecordHeader", testTruncatedRecordHeader);
+    run("testRleUniformImage", testRleUniformImage);
+    run("testRleLongRunsAcrossRows", testRleLongRunsAcrossRows);
+    run("testRleAlternatingPixels", testRleAlternatingPixels);
+    run("testRleEmptyImage", testRleEmptyImage);
+
+    if (numFailures > 0) {
+        std::cerr << numFailures << " checks failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}